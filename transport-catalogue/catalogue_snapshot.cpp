@@ -0,0 +1,75 @@
+#include "catalogue_snapshot.h"
+#include "serialization.h"
+
+#include <atomic>
+
+namespace transport {
+
+FrozenCatalogue::FrozenCatalogue()
+    : catalogue_(&arena_)
+    , router_(catalogue_)
+    , handler_(catalogue_, renderer_) {
+}
+
+std::shared_ptr<const FrozenCatalogue> FrozenCatalogue::Load(const std::string& file) {
+    auto snapshot = std::make_shared<FrozenCatalogue>();
+    snapshot->file_ = file;
+    Serializer serializer(snapshot->catalogue_, snapshot->renderer_, snapshot->router_, file);
+    if (!serializer.LoadData()) {
+        return nullptr;
+    }
+    return snapshot;
+}
+
+const TransportCatalogue& FrozenCatalogue::GetCatalogue() const {
+    return catalogue_;
+}
+
+const renderer::MapRenderer& FrozenCatalogue::GetRenderer() const {
+    return renderer_;
+}
+
+const TransportRouter& FrozenCatalogue::GetRouter() const {
+    return router_;
+}
+
+const RequestHandler& FrozenCatalogue::GetHandler() const {
+    return handler_;
+}
+
+const std::string& FrozenCatalogue::GetFile() const {
+    return file_;
+}
+
+RouteCache& FrozenCatalogue::GetRouteCache() const {
+    return route_cache_;
+}
+
+SnapshotHolder::SnapshotHolder()
+    : current_(std::make_shared<FrozenCatalogue>()) {
+}
+
+SnapshotHolder::SnapshotHolder(std::shared_ptr<const FrozenCatalogue> snapshot)
+    : current_(std::move(snapshot)) {
+}
+
+std::shared_ptr<const FrozenCatalogue> SnapshotHolder::Get() const {
+    return std::atomic_load(&current_);
+}
+
+void SnapshotHolder::Set(std::shared_ptr<const FrozenCatalogue> snapshot) {
+    std::atomic_store(&current_, std::move(snapshot));
+}
+
+std::future<bool> SnapshotHolder::ReloadAsync(std::string file) {
+    return std::async(std::launch::async, [this, file = std::move(file)]() {
+        auto snapshot = FrozenCatalogue::Load(file);
+        if (snapshot == nullptr) {
+            return false;
+        }
+        Set(std::move(snapshot));
+        return true;
+    });
+}
+
+} // end namespace transport
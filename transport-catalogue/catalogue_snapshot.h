@@ -0,0 +1,66 @@
+#pragma once
+
+#include "map_renderer.h"
+#include "request_handler.h"
+#include "route_cache.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <future>
+#include <memory>
+#include <memory_resource>
+#include <string>
+
+namespace transport {
+
+// Catalogue, render settings and a fully built router loaded from one snapshot file.
+// Nothing can be changed after loading, so one instance may serve any number of
+// threads through the const interface.
+class FrozenCatalogue {
+public:
+    FrozenCatalogue();
+    FrozenCatalogue(const FrozenCatalogue&) = delete;
+    FrozenCatalogue& operator=(const FrozenCatalogue&) = delete;
+
+    // Returns nullptr if the file can't be read or parsed
+    static std::shared_ptr<const FrozenCatalogue> Load(const std::string& file);
+
+    const TransportCatalogue& GetCatalogue() const;
+    const renderer::MapRenderer& GetRenderer() const;
+    const TransportRouter& GetRouter() const;
+    const RequestHandler& GetHandler() const;
+    const std::string& GetFile() const;
+    // Answers of Route requests, dropped together with the snapshot
+    RouteCache& GetRouteCache() const;
+
+private:
+    // The catalogue is filled once by Load and released in bulk with the snapshot
+    std::pmr::monotonic_buffer_resource arena_;
+    TransportCatalogue catalogue_;
+    renderer::MapRenderer renderer_;
+    TransportRouter router_;
+    RequestHandler handler_;
+    std::string file_;
+    mutable RouteCache route_cache_;
+};
+
+// Holds the current snapshot. Readers take a reference-counted pointer and keep
+// using it for as long as they need; Set() publishes a new snapshot atomically and
+// the old one is destroyed when its last reader lets go.
+class SnapshotHolder {
+public:
+    SnapshotHolder();
+    explicit SnapshotHolder(std::shared_ptr<const FrozenCatalogue> snapshot);
+
+    std::shared_ptr<const FrozenCatalogue> Get() const;
+    void Set(std::shared_ptr<const FrozenCatalogue> snapshot);
+
+    // Loads the file on a background thread and swaps it in when ready.
+    // The future is false if loading failed, the current snapshot stays then.
+    std::future<bool> ReloadAsync(std::string file);
+
+private:
+    std::shared_ptr<const FrozenCatalogue> current_;
+};
+
+} // end namespace transport
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "synthetic_city.h"
+
+using namespace std::literals;
+
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: city_generator [make_base|process_requests]"
+              " [--stops N] [--buses N] [--route-length N] [--roundtrip-ratio X]"
+              " [--road-density X] [--requests N] [--no-map] [--seed N] [--file NAME]\n"sv;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        PrintUsage();
+        return 1;
+    }
+    const std::string_view mode(argv[1]);
+    if (mode != "make_base"sv && mode != "process_requests"sv) {
+        PrintUsage();
+        return 1;
+    }
+
+    transport::synthetic::CityParams params;
+    try {
+        for (int i = 2; i < argc; ++i) {
+            const std::string_view option(argv[i]);
+            if (option == "--no-map"sv) {
+                params.with_map_request = false;
+                continue;
+            }
+            if (i + 1 == argc) {
+                PrintUsage();
+                return 1;
+            }
+            const std::string value(argv[++i]);
+            if (option == "--stops"sv) {
+                params.stop_count = std::stoul(value);
+            } else if (option == "--buses"sv) {
+                params.bus_count = std::stoul(value);
+            } else if (option == "--route-length"sv) {
+                params.route_length = std::stoul(value);
+            } else if (option == "--roundtrip-ratio"sv) {
+                params.roundtrip_ratio = std::stod(value);
+            } else if (option == "--road-density"sv) {
+                params.road_distance_density = std::stod(value);
+            } else if (option == "--requests"sv) {
+                params.stat_request_count = std::stoul(value);
+            } else if (option == "--seed"sv) {
+                params.seed = static_cast<uint32_t>(std::stoul(value));
+            } else if (option == "--file"sv) {
+                params.file = value;
+            } else {
+                PrintUsage();
+                return 1;
+            }
+        }
+    } catch (const std::exception&) {
+        PrintUsage();
+        return 1;
+    }
+    if (params.stop_count < 2 || params.route_length < 2) {
+        std::cerr << "At least 2 stops and 2 stops per route are required" << std::endl;
+        return 1;
+    }
+
+    if (mode == "make_base"sv) {
+        json::Print(transport::synthetic::GenerateMakeBase(params), std::cout);
+    } else {
+        json::Print(transport::synthetic::GenerateProcessRequests(params), std::cout);
+    }
+    std::cout << std::endl;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Single-source shortest paths computed on demand. Edge weights come from a
+// callback, so one graph can be searched under different settings. The search
+// stops once the target (or every one of the targets) is settled or the next
+// weight exceeds max_weight.
+template <typename Weight>
+class ShortestPathTree {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    template <typename WeightFunc>
+    ShortestPathTree(const Graph& graph, VertexId from, WeightFunc edge_weight,
+                     std::optional<Weight> max_weight = std::nullopt,
+                     std::optional<VertexId> target = std::nullopt);
+    // One search for paths to several targets, e.g. for a batch of requests from one stop
+    template <typename WeightFunc>
+    ShortestPathTree(const Graph& graph, VertexId from, WeightFunc edge_weight, const std::vector<VertexId>& targets);
+
+    bool IsReached(VertexId vertex) const;
+    Weight GetWeight(VertexId vertex) const;
+    // Edges of the path from the source, in travel order
+    std::vector<EdgeId> GetEdges(VertexId to) const;
+    // Settled vertices in the order of non-decreasing weight
+    const std::vector<VertexId>& GetReached() const;
+    // Last edge of the path to the vertex, none for the source
+    std::optional<EdgeId> GetPrevEdge(VertexId vertex) const;
+
+private:
+    template <typename WeightFunc>
+    void Search(VertexId from, WeightFunc& edge_weight, std::optional<Weight> max_weight, const std::vector<VertexId>& targets);
+
+    const Graph& graph_;
+    std::vector<Weight> weights_;
+    std::vector<std::optional<EdgeId>> prev_edges_;
+    std::vector<bool> settled_;
+    std::vector<VertexId> reached_;
+};
+
+template <typename Weight>
+template <typename WeightFunc>
+ShortestPathTree<Weight>::ShortestPathTree(const Graph& graph, VertexId from, WeightFunc edge_weight,
+                                           std::optional<Weight> max_weight, std::optional<VertexId> target)
+    : graph_(graph)
+    , weights_(graph.GetVertexCount())
+    , prev_edges_(graph.GetVertexCount())
+    , settled_(graph.GetVertexCount(), false) {
+    Search(from, edge_weight, max_weight, target ? std::vector<VertexId>{*target} : std::vector<VertexId>{});
+}
+
+template <typename Weight>
+template <typename WeightFunc>
+ShortestPathTree<Weight>::ShortestPathTree(const Graph& graph, VertexId from, WeightFunc edge_weight,
+                                           const std::vector<VertexId>& targets)
+    : graph_(graph)
+    , weights_(graph.GetVertexCount())
+    , prev_edges_(graph.GetVertexCount())
+    , settled_(graph.GetVertexCount(), false) {
+    Search(from, edge_weight, std::nullopt, targets);
+}
+
+template <typename Weight>
+template <typename WeightFunc>
+void ShortestPathTree<Weight>::Search(VertexId from, WeightFunc& edge_weight, std::optional<Weight> max_weight,
+                                      const std::vector<VertexId>& targets) {
+    const Graph& graph = graph_;
+    // without targets the whole reachable part is settled
+    std::vector<bool> is_target(targets.empty() ? 0 : graph.GetVertexCount(), false);
+    size_t remaining_targets = 0;
+    for (VertexId target : targets) {
+        if (!is_target.at(target)) {
+            is_target[target] = true;
+            ++remaining_targets;
+        }
+    }
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+    std::vector<bool> queued(graph.GetVertexCount(), false);
+    weights_.at(from) = Weight{};
+    queued[from] = true;
+    queue.push({Weight{}, from});
+    while (!queue.empty()) {
+        auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (settled_[vertex] || weight > weights_[vertex]) {
+            continue;
+        }
+        if (max_weight && weight > *max_weight) {
+            break;
+        }
+        settled_[vertex] = true;
+        reached_.push_back(vertex);
+        if (!is_target.empty() && is_target[vertex] && --remaining_targets == 0) {
+            break;
+        }
+        for (EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            const auto& edge = graph.GetEdge(edge_id);
+            const Weight edge_weight_value = edge_weight(edge);
+            if (edge_weight_value < Weight{}) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            const Weight candidate = weight + edge_weight_value;
+            if (!queued[edge.to] || candidate < weights_[edge.to]) {
+                queued[edge.to] = true;
+                weights_[edge.to] = candidate;
+                prev_edges_[edge.to] = edge_id;
+                queue.push({candidate, edge.to});
+            }
+        }
+    }
+}
+
+template <typename Weight>
+bool ShortestPathTree<Weight>::IsReached(VertexId vertex) const {
+    return settled_.at(vertex);
+}
+
+template <typename Weight>
+Weight ShortestPathTree<Weight>::GetWeight(VertexId vertex) const {
+    return weights_.at(vertex);
+}
+
+template <typename Weight>
+std::vector<EdgeId> ShortestPathTree<Weight>::GetEdges(VertexId to) const {
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = prev_edges_.at(to); edge_id; edge_id = prev_edges_[graph_.GetEdge(*edge_id).from]) {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    return edges;
+}
+
+template <typename Weight>
+const std::vector<VertexId>& ShortestPathTree<Weight>::GetReached() const {
+    return reached_;
+}
+
+template <typename Weight>
+std::optional<EdgeId> ShortestPathTree<Weight>::GetPrevEdge(VertexId vertex) const {
+    return prev_edges_.at(vertex);
+}
+
+}  // namespace graph
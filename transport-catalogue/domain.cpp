@@ -2,6 +2,10 @@
 
 namespace transport {
 
+RouteView Bus::GetRoute() const {
+    return RouteView(stops, !is_roundtrip);
+}
+
 size_t StopHasher::operator()(std::pair<const Stop*, const Stop*> stops) const {
     return std::hash<const void*>{}(stops.first) + 37 * std::hash<const void*>{}(stops.second);
 }
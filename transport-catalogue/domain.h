@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <iterator>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -10,15 +13,92 @@ namespace transport {
 
 struct Stop {
     size_t id;
-    std::string name;
+    std::string_view name; // owned by the catalogue's NamePool
     geo::Coordinates coordinates;
 };
 
+// All stops a bus passes in riding order, read from the stored ones without a
+// copy: the way back of a non-roundtrip bus is its way there read backwards
+class RouteView {
+public:
+    class Iterator;
+
+    RouteView(const std::pmr::vector<const Stop*>& stops, bool there_and_back)
+        : stops_(stops.data())
+        , count_(stops.size())
+        , there_and_back_(there_and_back) {
+    }
+    size_t size() const {
+        return there_and_back_ && count_ != 0 ? 2 * count_ - 1 : count_;
+    }
+    bool empty() const {
+        return count_ == 0;
+    }
+    const Stop* operator[](size_t index) const {
+        return index < count_ ? stops_[index] : stops_[2 * count_ - 2 - index];
+    }
+    Iterator begin() const;
+    Iterator end() const;
+
+private:
+    const Stop* const* stops_;
+    size_t count_;
+    bool there_and_back_;
+};
+
+class RouteView::Iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = const Stop*;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Stop* const*;
+    using reference = const Stop*;
+
+    Iterator(const RouteView& view, size_t index)
+        : view_(view)
+        , index_(index) {
+    }
+    reference operator*() const {
+        return view_[index_];
+    }
+    Iterator& operator++() {
+        ++index_;
+        return *this;
+    }
+    Iterator operator++(int) {
+        Iterator old = *this;
+        ++index_;
+        return old;
+    }
+    bool operator==(const Iterator& other) const {
+        return index_ == other.index_;
+    }
+    bool operator!=(const Iterator& other) const {
+        return index_ != other.index_;
+    }
+
+private:
+    RouteView view_; // a copy, so iterators outlive a temporary view
+    size_t index_;
+};
+
+inline RouteView::Iterator RouteView::begin() const {
+    return Iterator(*this, 0);
+}
+
+inline RouteView::Iterator RouteView::end() const {
+    return Iterator(*this, size());
+}
+
 struct Bus {
     size_t id;
-    std::string name;
-    std::vector<const Stop*> stops; // all stops, including way back
+    std::string_view name; // owned by the catalogue's NamePool
+    // A roundtrip ends at its first stop, other buses keep only the way there
+    std::pmr::vector<const Stop*> stops;
     bool is_roundtrip;
+
+    // All stops in riding order, including the way back
+    RouteView GetRoute() const;
 };
 
 struct BusInfo {
@@ -29,6 +109,20 @@ struct BusInfo {
     double curvature;
 };
 
+// Boarding a bus at a stop and riding it span_count stops
+struct RouteLeg {
+    const Stop* stop;
+    const Bus* bus;
+    int span_count;
+    double wait_time;
+    double bus_time;
+};
+
+struct Journey {
+    double total_time;
+    std::vector<RouteLeg> legs;
+};
+
 class StopHasher {
     public:
     size_t operator()(std::pair<const Stop*, const Stop*> stops) const;
@@ -1,8 +1,79 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSPORT_GEO_AVX2
+#include <immintrin.h>
+#endif
+
 namespace transport {
 namespace geo {
+
+namespace {
+
+const double DR = M_PI / 180.;
+
+// Trigonometry of the point distances are computed from
+struct Origin {
+    double sin_half_lat;
+    double cos_half_lat;
+    double cos_lat;
+    double sin_half_lng;
+    double cos_half_lng;
+};
+
+Origin MakeOrigin(Coordinates c) {
+    return {std::sin(c.lat * DR / 2), std::cos(c.lat * DR / 2), std::cos(c.lat * DR),
+            std::sin(c.lng * DR / 2), std::cos(c.lng * DR / 2)};
+}
+
+struct Columns {
+    const double* sin_half_lat;
+    const double* cos_half_lat;
+    const double* cos_lat;
+    const double* sin_half_lng;
+    const double* cos_half_lng;
+};
+
+// Both kernels store sqrt of the haversine of the central angle, the final asin is shared.
+// sin((b - a) / 2) is expanded as sin(b/2)cos(a/2) - cos(b/2)sin(a/2) from cached halves.
+void ComputeHaversineScalar(const Origin& from, const Columns& to, size_t begin, size_t end, double* out) {
+    for (size_t i = begin; i < end; ++i) {
+        double sin_dlat = to.sin_half_lat[i] * from.cos_half_lat - to.cos_half_lat[i] * from.sin_half_lat;
+        double sin_dlng = to.sin_half_lng[i] * from.cos_half_lng - to.cos_half_lng[i] * from.sin_half_lng;
+        double h = sin_dlat * sin_dlat + (from.cos_lat * to.cos_lat[i]) * (sin_dlng * sin_dlng);
+        out[i] = std::sqrt(std::min(h, 1.0));
+    }
+}
+
+#ifdef TRANSPORT_GEO_AVX2
+// Explicit mul/sub/add without FMA, so lanes match the scalar kernel bit for bit
+__attribute__((target("avx2")))
+size_t ComputeHaversineAvx2(const Origin& from, const Columns& to, size_t count, double* out) {
+    const __m256d from_sin_half_lat = _mm256_set1_pd(from.sin_half_lat);
+    const __m256d from_cos_half_lat = _mm256_set1_pd(from.cos_half_lat);
+    const __m256d from_cos_lat = _mm256_set1_pd(from.cos_lat);
+    const __m256d from_sin_half_lng = _mm256_set1_pd(from.sin_half_lng);
+    const __m256d from_cos_half_lng = _mm256_set1_pd(from.cos_half_lng);
+    const __m256d one = _mm256_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d sin_dlat = _mm256_sub_pd(_mm256_mul_pd(_mm256_loadu_pd(to.sin_half_lat + i), from_cos_half_lat),
+                                         _mm256_mul_pd(_mm256_loadu_pd(to.cos_half_lat + i), from_sin_half_lat));
+        __m256d sin_dlng = _mm256_sub_pd(_mm256_mul_pd(_mm256_loadu_pd(to.sin_half_lng + i), from_cos_half_lng),
+                                         _mm256_mul_pd(_mm256_loadu_pd(to.cos_half_lng + i), from_sin_half_lng));
+        __m256d h = _mm256_add_pd(_mm256_mul_pd(sin_dlat, sin_dlat),
+                                  _mm256_mul_pd(_mm256_mul_pd(from_cos_lat, _mm256_loadu_pd(to.cos_lat + i)),
+                                                _mm256_mul_pd(sin_dlng, sin_dlng)));
+        _mm256_storeu_pd(out + i, _mm256_sqrt_pd(_mm256_min_pd(h, one)));
+    }
+    return i;
+}
+#endif
+
+} // namespace
     
 bool Coordinates::operator==(const Coordinates& other) const {
         return lat == other.lat && lng == other.lng;
@@ -23,5 +94,75 @@ double ComputeDistance(Coordinates from, Coordinates to) {
         * EARTH_RADIUS;
 }
 
+double ComputeHaversineDistance(Coordinates from, Coordinates to) {
+    double sin_dlat = std::sin((to.lat - from.lat) * DR / 2);
+    double sin_dlng = std::sin((to.lng - from.lng) * DR / 2);
+    double h = sin_dlat * sin_dlat + std::cos(from.lat * DR) * std::cos(to.lat * DR) * sin_dlng * sin_dlng;
+    return 2 * EARTH_RADIUS * std::asin(std::sqrt(std::min(h, 1.0)));
+}
+
+void TrigPoints::Add(Coordinates coordinates) {
+    lat_.push_back(coordinates.lat);
+    lng_.push_back(coordinates.lng);
+    sin_lat_.push_back(std::sin(coordinates.lat * DR));
+    cos_lat_.push_back(std::cos(coordinates.lat * DR));
+    sin_half_lat_.push_back(std::sin(coordinates.lat * DR / 2));
+    cos_half_lat_.push_back(std::cos(coordinates.lat * DR / 2));
+    sin_half_lng_.push_back(std::sin(coordinates.lng * DR / 2));
+    cos_half_lng_.push_back(std::cos(coordinates.lng * DR / 2));
+}
+
+void TrigPoints::Reserve(size_t count) {
+    for (auto* column : {&lat_, &lng_, &sin_lat_, &cos_lat_, &sin_half_lat_, &cos_half_lat_, &sin_half_lng_, &cos_half_lng_}) {
+        column->reserve(count);
+    }
+}
+
+void TrigPoints::Clear() {
+    for (auto* column : {&lat_, &lng_, &sin_lat_, &cos_lat_, &sin_half_lat_, &cos_half_lat_, &sin_half_lng_, &cos_half_lng_}) {
+        column->clear();
+    }
+}
+
+size_t TrigPoints::GetSize() const {
+    return lng_.size();
+}
+
+double TrigPoints::ComputeDistance(size_t from, size_t to) const {
+    if (lat_[from] == lat_[to] && lng_[from] == lng_[to]) {
+        return 0;
+    }
+    return std::acos(sin_lat_[from] * sin_lat_[to]
+                     + cos_lat_[from] * cos_lat_[to] * std::cos(std::abs(lng_[from] - lng_[to]) * DR))
+        * EARTH_RADIUS;
+}
+
+void TrigPoints::ComputeDistancesFrom(Coordinates from, std::vector<double>& out, [[maybe_unused]] BatchKernel kernel) const {
+    const size_t count = GetSize();
+    out.resize(count);
+    const Origin origin = MakeOrigin(from);
+    const Columns columns{sin_half_lat_.data(), cos_half_lat_.data(), cos_lat_.data(),
+                          sin_half_lng_.data(), cos_half_lng_.data()};
+    size_t done = 0;
+#ifdef TRANSPORT_GEO_AVX2
+    if (kernel != BatchKernel::SCALAR && IsAvx2Supported()) {
+        done = ComputeHaversineAvx2(origin, columns, count, out.data());
+    }
+#endif
+    ComputeHaversineScalar(origin, columns, done, count, out.data());
+    for (double& d : out) {
+        d = 2 * EARTH_RADIUS * std::asin(d);
+    }
+}
+
+bool IsAvx2Supported() {
+#ifdef TRANSPORT_GEO_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
 } // end namespace geo
 } // end namespace transport
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cmath>
+#include <vector>
 
 namespace transport {
 namespace geo {
@@ -15,6 +16,42 @@ struct Coordinates {
 };
 
 double ComputeDistance(Coordinates from, Coordinates to);
+// Haversine formula: same distance, but stays precise for close points
+double ComputeHaversineDistance(Coordinates from, Coordinates to);
+
+enum class BatchKernel {
+    AUTO,   // AVX2 if the CPU supports it
+    SCALAR,
+    AVX2    // falls back to SCALAR where unavailable
+};
+
+// Points with their trigonometry computed once, stored column-wise so that
+// distances from one point to all of them can be computed in SIMD lanes.
+class TrigPoints {
+public:
+    void Add(Coordinates coordinates);
+    void Reserve(size_t count);
+    void Clear();
+    size_t GetSize() const;
+
+    // Same formula and result as ComputeDistance for the two points, without trigonometry
+    double ComputeDistance(size_t from, size_t to) const;
+    // Haversine distances from the given point to every point, out is resized to GetSize()
+    void ComputeDistancesFrom(Coordinates from, std::vector<double>& out,
+                              BatchKernel kernel = BatchKernel::AUTO) const;
+
+private:
+    std::vector<double> lat_;
+    std::vector<double> lng_;
+    std::vector<double> sin_lat_;
+    std::vector<double> cos_lat_;
+    std::vector<double> sin_half_lat_;
+    std::vector<double> cos_half_lat_;
+    std::vector<double> sin_half_lng_;
+    std::vector<double> cos_half_lng_;
+};
+
+bool IsAvx2Supported();
     
 } // end namespace geo
 } // end namespace transport
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "geo.h"
+
+using namespace std::literals;
+
+// Checks the cached trigonometry and the batch haversine kernels against
+// geo::ComputeDistance and compares their speed. Exits with 1 if a batch distance
+// is off by more than MAX_ABS_ERROR meters and MAX_REL_ERROR of the distance,
+// or the AVX2 lanes differ from the scalar kernel.
+
+namespace {
+
+using transport::geo::BatchKernel;
+using transport::geo::Coordinates;
+using transport::geo::TrigPoints;
+
+// the acos reference itself is off by up to a few centimeters for close points
+constexpr double MAX_ABS_ERROR = 0.1;
+constexpr double MAX_REL_ERROR = 1e-6;
+
+struct Error {
+    double max_abs = 0.0;
+    double max_rel = 0.0;
+
+    void Add(double expected, double actual) {
+        double abs_error = std::abs(expected - actual);
+        max_abs = std::max(max_abs, abs_error);
+        if (expected > 1.0) {
+            max_rel = std::max(max_rel, abs_error / expected);
+        }
+    }
+};
+
+template <typename Func>
+double MeasureMs(Func func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PrintRow(std::string_view name, double ms, const Error& error) {
+    std::cout << "  " << name << std::string(22 - std::min<size_t>(name.size(), 21), ' ')
+              << ms << " ms, max abs error " << error.max_abs << " m, max rel error " << error.max_rel << '\n';
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t point_count = argc > 1 ? std::stoul(argv[1]) : 20000;
+    size_t origin_count = argc > 2 ? std::stoul(argv[2]) : 200;
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> lat(55.5, 56.0);
+    std::uniform_real_distribution<double> lng(37.3, 37.9);
+    std::vector<Coordinates> points(point_count);
+    TrigPoints trig_points;
+    trig_points.Reserve(point_count);
+    for (auto& p : points) {
+        p = {lat(gen), lng(gen)};
+        trig_points.Add(p);
+    }
+    origin_count = std::min(origin_count, point_count);
+
+    std::vector<double> reference(point_count * origin_count);
+    double reference_ms = MeasureMs([&] {
+        for (size_t o = 0; o < origin_count; ++o) {
+            for (size_t i = 0; i < point_count; ++i) {
+                reference[o * point_count + i] = transport::geo::ComputeDistance(points[o], points[i]);
+            }
+        }
+    });
+
+    Error cached_error;
+    double cached_ms = MeasureMs([&] {
+        for (size_t o = 0; o < origin_count; ++o) {
+            for (size_t i = 0; i < point_count; ++i) {
+                cached_error.Add(reference[o * point_count + i], trig_points.ComputeDistance(o, i));
+            }
+        }
+    });
+
+    Error haversine_error;
+    double haversine_ms = MeasureMs([&] {
+        for (size_t o = 0; o < origin_count; ++o) {
+            for (size_t i = 0; i < point_count; ++i) {
+                haversine_error.Add(reference[o * point_count + i],
+                                    transport::geo::ComputeHaversineDistance(points[o], points[i]));
+            }
+        }
+    });
+
+    std::cout << "points " << point_count << ", origins " << origin_count
+              << ", avx2 " << (transport::geo::IsAvx2Supported() ? "yes"sv : "no"sv) << '\n';
+    PrintRow("acos"sv, reference_ms, Error{});
+    PrintRow("acos cached"sv, cached_ms, cached_error);
+    PrintRow("haversine"sv, haversine_ms, haversine_error);
+
+    std::vector<std::pair<std::string_view, BatchKernel>> kernels{{"batch scalar"sv, BatchKernel::SCALAR}};
+    if (transport::geo::IsAvx2Supported()) {
+        kernels.push_back({"batch avx2"sv, BatchKernel::AVX2});
+    }
+    bool ok = true;
+    std::vector<double> scalar(point_count * origin_count);
+    for (auto [name, kernel] : kernels) {
+        Error error;
+        size_t lane_mismatches = 0;
+        size_t out_of_tolerance = 0;
+        std::vector<double> distances;
+        double ms = 0.0;
+        for (size_t o = 0; o < origin_count; ++o) {
+            ms += MeasureMs([&] {
+                trig_points.ComputeDistancesFrom(points[o], distances, kernel);
+            });
+            for (size_t i = 0; i < point_count; ++i) {
+                const double expected = reference[o * point_count + i];
+                error.Add(expected, distances[i]);
+                if (std::abs(expected - distances[i]) > std::max(MAX_ABS_ERROR, MAX_REL_ERROR * expected)) {
+                    ++out_of_tolerance;
+                }
+                if (kernel == BatchKernel::SCALAR) {
+                    scalar[o * point_count + i] = distances[i];
+                } else if (distances[i] != scalar[o * point_count + i]) {
+                    ++lane_mismatches;
+                }
+            }
+        }
+        PrintRow(name, ms, error);
+        if (out_of_tolerance != 0) {
+            std::cout << "  " << name << ": " << out_of_tolerance << " distances are off by more than "
+                      << MAX_ABS_ERROR << " m and " << MAX_REL_ERROR << " relative\n";
+            ok = false;
+        }
+        if (lane_mismatches != 0) {
+            std::cout << "  " << name << ": " << lane_mismatches << " distances differ from batch scalar\n";
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
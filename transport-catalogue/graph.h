@@ -1,8 +1,15 @@
 #pragma once
 
+#include "parallel.h"
 #include "ranges.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
 #include <vector>
 
 #include <graph.pb.h>
@@ -15,24 +22,40 @@ using EdgeId = size_t;
 
 template <typename Weight>
 struct Edge {
-    VertexId from;
-    VertexId to;
+    uint32_t from;
+    uint32_t to;
     Weight weight;
-    size_t bus_id;
-    size_t stop_count;
+    uint32_t bus_id;
+    uint16_t stop_count;
+    double distance; // road distance in meters, weight is derived from it and routing settings
 };
 
+// Edges are collected with AddEdge and then packed once by Finalize() into
+// compressed sparse rows: edges sorted by source and an offset per vertex, so the
+// incident edges of a vertex are a contiguous range of edge ids. Only a finalized
+// graph can be traversed.
 template <typename Weight>
 class DirectedWeightedGraph {
 private:
-    using IncidenceList = std::vector<EdgeId>;
-    using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+    using IncidentEdgesRange = ranges::Range<ranges::CountingIterator<EdgeId>>;
 
 public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
-    DirectedWeightedGraph(const router_serialize::Graph& graph);
+    // Loads a finalized graph. Files written before the packed layout are packed on
+    // load; then old_edge_ids, if given, receives the new id of every stored edge id.
+    DirectedWeightedGraph(const router_serialize::Graph& graph, std::vector<EdgeId>* old_edge_ids = nullptr);
     EdgeId AddEdge(const Edge<Weight>& edge);
+    // Stable sort by source: edges of one vertex keep their order, ids change.
+    // Returns the new id of every old edge id.
+    std::vector<EdgeId> Finalize();
+    bool IsFinalized() const;
+    // Removes edges that can't be on a shortest path: self-loops and edges for which
+    // another edge between the same vertices is no longer and either lighter or
+    // earlier. The first lightest edge of every vertex pair stays, so shortest paths
+    // and their ties are unchanged, also for weights recomputed from distance.
+    // Source vertices are processed in parallel. Returns the number of removed edges.
+    size_t RemoveDominatedEdges(size_t thread_count);
 
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
@@ -42,46 +65,151 @@ public:
     router_serialize::Graph SerializeGraph() const;
 
 private:
+    size_t vertex_count_ = 0;
     std::vector<Edge<Weight>> edges_;
-    std::vector<IncidenceList> incidence_lists_;
+    std::vector<uint32_t> offsets_; // vertex_count_ + 1 items once finalized
 };
 
+// Weakly connected components: vertices joined by an edge in either direction share
+// a component, so there is no path between vertices of different components.
+// Components are numbered in the order of their smallest vertex.
+template <typename Weight>
+std::vector<size_t> ComputeWeakComponents(const DirectedWeightedGraph<Weight>& graph);
+
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-    : incidence_lists_(vertex_count) {
+    : vertex_count_(vertex_count) {
+    if (vertex_count > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Too many graph vertices");
+    }
 }
 
 template <typename Weight>
-DirectedWeightedGraph<Weight>::DirectedWeightedGraph(const router_serialize::Graph& graph) {
+DirectedWeightedGraph<Weight>::DirectedWeightedGraph(const router_serialize::Graph& graph, std::vector<EdgeId>* old_edge_ids) {
+    edges_.reserve(graph.edges_size());
     for (int i = 0; i < graph.edges_size(); ++i) {
-        Edge<double> e;
+        Edge<Weight> e;
         e.bus_id = graph.edges(i).bus_id();
         e.from = graph.edges(i).from();
         e.to = graph.edges(i).to();
         e.weight = graph.edges(i).weight();
-        e.stop_count = graph.edges(i).stop_count();
+        e.stop_count = static_cast<uint16_t>(graph.edges(i).stop_count());
+        e.distance = graph.edges(i).distance();
         edges_.push_back(std::move(e));
     }
-    for (int i = 0; i < graph.incidence_lists_size(); ++i) {
-        IncidenceList list;
-        for (int j = 0; j < graph.incidence_lists(i).edge_ids_size(); ++j) {
-            list.push_back(graph.incidence_lists(i).edge_ids(j));
-        }
-        incidence_lists_.push_back(std::move(list));
+    if (graph.offsets_size() != 0) {
+        vertex_count_ = graph.offsets_size() - 1;
+        offsets_.assign(graph.offsets().begin(), graph.offsets().end());
+        return;
+    }
+    // older file with incidence lists, edge ids were in insertion order
+    vertex_count_ = graph.incidence_lists_size();
+    std::vector<EdgeId> new_ids = Finalize();
+    if (old_edge_ids != nullptr) {
+        *old_edge_ids = std::move(new_ids);
     }
 }
 
 template <typename Weight>
 EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+    if (IsFinalized()) {
+        throw std::logic_error("Graph is already finalized");
+    }
+    if (edge.from >= vertex_count_ || edge.to >= vertex_count_) {
+        throw std::out_of_range("Edge vertex is out of range");
+    }
     edges_.push_back(edge);
-    const EdgeId id = edges_.size() - 1;
-    incidence_lists_.at(edge.from).push_back(id);
-    return id;
+    return edges_.size() - 1;
+}
+
+template <typename Weight>
+std::vector<EdgeId> DirectedWeightedGraph<Weight>::Finalize() {
+    std::vector<EdgeId> new_ids(edges_.size());
+    if (IsFinalized()) {
+        std::iota(new_ids.begin(), new_ids.end(), 0);
+        return new_ids;
+    }
+    if (edges_.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Too many graph edges");
+    }
+    // counting sort by source keeps the insertion order within a vertex
+    offsets_.assign(vertex_count_ + 1, 0);
+    for (const auto& edge : edges_) {
+        ++offsets_[edge.from + 1];
+    }
+    std::partial_sum(offsets_.begin(), offsets_.end(), offsets_.begin());
+    std::vector<uint32_t> next(offsets_.begin(), offsets_.end() - 1);
+    std::vector<Edge<Weight>> sorted(edges_.size());
+    for (EdgeId id = 0; id < edges_.size(); ++id) {
+        new_ids[id] = next[edges_[id].from]++;
+        sorted[new_ids[id]] = edges_[id];
+    }
+    edges_ = std::move(sorted);
+    return new_ids;
+}
+
+template <typename Weight>
+size_t DirectedWeightedGraph<Weight>::RemoveDominatedEdges(size_t thread_count) {
+    if (!IsFinalized()) {
+        throw std::logic_error("Graph is not finalized");
+    }
+    auto dominates = [this](EdgeId lhs, EdgeId rhs) {
+        const auto& l = edges_[lhs];
+        const auto& r = edges_[rhs];
+        return l.distance <= r.distance && (l.weight < r.weight || (l.weight == r.weight && lhs < rhs));
+    };
+    std::vector<char> kept(edges_.size(), 1);
+    std::vector<uint32_t> kept_counts(vertex_count_, 0);
+    transport::parallel::ForEachChunk(vertex_count_, thread_count, [&](size_t begin, size_t end, size_t) {
+        std::vector<EdgeId> order;
+        for (VertexId vertex = begin; vertex < end; ++vertex) {
+            order.assign(ranges::CountingIterator<EdgeId>(offsets_[vertex]),
+                         ranges::CountingIterator<EdgeId>(offsets_[vertex + 1]));
+            std::stable_sort(order.begin(), order.end(), [this](EdgeId lhs, EdgeId rhs) {
+                return edges_[lhs].to < edges_[rhs].to;
+            });
+            uint32_t count = 0;
+            for (size_t group = 0, group_end = 0; group < order.size(); group = group_end) {
+                while (group_end < order.size() && edges_[order[group_end]].to == edges_[order[group]].to) {
+                    ++group_end;
+                }
+                for (size_t i = group; i < group_end; ++i) {
+                    bool dominated = edges_[order[i]].to == vertex;
+                    for (size_t j = group; j < group_end && !dominated; ++j) {
+                        dominated = j != i && dominates(order[j], order[i]);
+                    }
+                    kept[order[i]] = !dominated;
+                    count += !dominated;
+                }
+            }
+            kept_counts[vertex] = count;
+        }
+    });
+
+    // compaction keeps the order of the remaining edges
+    EdgeId next = 0;
+    for (EdgeId id = 0; id < edges_.size(); ++id) {
+        if (kept[id]) {
+            edges_[next++] = edges_[id];
+        }
+    }
+    const size_t removed = edges_.size() - next;
+    edges_.resize(next);
+    edges_.shrink_to_fit();
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        offsets_[vertex + 1] = offsets_[vertex] + kept_counts[vertex];
+    }
+    return removed;
+}
+
+template <typename Weight>
+bool DirectedWeightedGraph<Weight>::IsFinalized() const {
+    return !offsets_.empty();
 }
 
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-    return incidence_lists_.size();
+    return vertex_count_;
 }
 
 template <typename Weight>
@@ -91,38 +219,69 @@ size_t DirectedWeightedGraph<Weight>::GetEdgeCount() const {
 
 template <typename Weight>
 const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
-    return edges_.at(edge_id);
+    assert(edge_id < edges_.size());
+    return edges_[edge_id];
 }
 
 template <typename Weight>
 typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-    return ranges::AsRange(incidence_lists_.at(vertex));
+    if (!IsFinalized()) {
+        throw std::logic_error("Graph is not finalized");
+    }
+    assert(vertex < vertex_count_);
+    return IncidentEdgesRange{ranges::CountingIterator<EdgeId>(offsets_[vertex]),
+                              ranges::CountingIterator<EdgeId>(offsets_[vertex + 1])};
 }
 
 template<typename Weight>
 router_serialize::Graph DirectedWeightedGraph<Weight>::SerializeGraph() const {
+    if (!IsFinalized()) {
+        throw std::logic_error("Graph is not finalized");
+    }
     router_serialize::Graph g;
+    g.mutable_edges()->Reserve(static_cast<int>(edges_.size()));
+    for (const auto& edge : edges_) {
+        router_serialize::Edge& e = *g.add_edges();
+        e.set_from(edge.from);
+        e.set_to(edge.to);
+        e.set_bus_id(edge.bus_id);
+        e.set_weight(edge.weight);
+        e.set_stop_count(edge.stop_count);
+        e.set_distance(edge.distance);
+    }
+    g.mutable_offsets()->Add(offsets_.begin(), offsets_.end());
+    return g;
+}
 
-    for(size_t i = 0; i < incidence_lists_.size(); ++i) {
-        router_serialize::IncidenceList list;
-        for(size_t j = 0; j < incidence_lists_.at(i).size(); ++j) {
-            list.add_edge_ids(incidence_lists_.at(i).at(j));
+template <typename Weight>
+std::vector<size_t> ComputeWeakComponents(const DirectedWeightedGraph<Weight>& graph) {
+    const size_t vertex_count = graph.GetVertexCount();
+    std::vector<size_t> parents(vertex_count);
+    std::iota(parents.begin(), parents.end(), 0);
+    auto find_root = [&parents](size_t vertex) {
+        while (parents[vertex] != vertex) {
+            parents[vertex] = parents[parents[vertex]];
+            vertex = parents[vertex];
+        }
+        return vertex;
+    };
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        size_t from_root = find_root(edge.from);
+        size_t to_root = find_root(edge.to);
+        if (from_root != to_root) {
+            parents[std::max(from_root, to_root)] = std::min(from_root, to_root);
         }
-        g.add_incidence_lists();
-        *g.mutable_incidence_lists((int)i) = std::move(list);
-    }
-    for(size_t i = 0; i < edges_.size(); ++i) {
-        router_serialize::Edge e;
-        e.set_from(edges_.at(i).from);
-        e.set_to(edges_.at(i).to);
-        e.set_bus_id(edges_.at(i).bus_id);
-        e.set_weight(edges_.at(i).weight);
-        e.set_stop_count(edges_.at(i).stop_count);
-        g.add_edges();
-        *g.mutable_edges(i) = std::move(e);
     }
-    return g;
+    // roots are the smallest vertices of their components
+    std::vector<size_t> components(vertex_count);
+    size_t component_count = 0;
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+        size_t root = find_root(vertex);
+        components[vertex] = root == vertex ? component_count++ : components[root];
+    }
+    return components;
 }
 
 }  // namespace graph
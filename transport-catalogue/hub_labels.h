@@ -0,0 +1,326 @@
+#pragma once
+
+#include "dijkstra.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Two-hop distance labels (pruned landmark labeling). Every vertex keeps the hubs
+// it reaches and the hubs reaching it with the distances; the distance between two
+// vertices is the minimum over their common hubs, found by merging two sorted labels.
+// Hubs are numbered by rank: vertices on more shortest paths come first.
+template <typename Weight>
+class HubLabels {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    // Labels of all vertices packed like graph rows: entries of vertex v are
+    // [offsets[v], offsets[v + 1]), sorted by hub. The parent is the next edge of the
+    // path towards the hub (forward labels) or from it (backward labels).
+    struct LabelSet {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> hubs;
+        std::vector<Weight> weights;
+        std::vector<uint32_t> parents;
+    };
+    static constexpr uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+    static constexpr size_t ORDER_SAMPLE_COUNT = 64;
+
+    HubLabels() = default;
+    explicit HubLabels(const Graph& graph);
+    HubLabels(LabelSet forward, LabelSet backward);
+
+    bool IsEmpty() const;
+    size_t GetEntryCount() const;
+    const LabelSet& GetForwardLabels() const;
+    const LabelSet& GetBackwardLabels() const;
+
+    std::optional<Weight> GetWeight(VertexId from, VertexId to) const;
+    // Edges of the path are recovered by following label parents
+    std::optional<typename Router<Weight>::RouteInfo> BuildRoute(const Graph& graph, VertexId from, VertexId to) const;
+
+private:
+    struct Entry {
+        uint32_t hub;
+        Weight weight;
+        uint32_t parent;
+    };
+    using Labels = std::vector<std::vector<Entry>>;
+
+    // Common hub with the least total weight, the lowest hub of equal ones
+    std::optional<std::pair<uint32_t, Weight>> FindHub(VertexId from, VertexId to) const;
+    static size_t FindEntry(const LabelSet& labels, VertexId vertex, uint32_t hub);
+    static LabelSet Pack(Labels labels);
+
+    LabelSet forward_; // hubs reachable from the vertex
+    LabelSet backward_; // hubs the vertex is reachable from
+};
+
+template <typename Weight>
+HubLabels<Weight>::HubLabels(const Graph& graph) {
+    const size_t vertex_count = graph.GetVertexCount();
+    if (vertex_count == 0) {
+        return;
+    }
+    // incoming edges of every vertex for the backward searches
+    std::vector<uint32_t> in_offsets(vertex_count + 1, 0);
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        ++in_offsets[graph.GetEdge(edge_id).to + 1];
+    }
+    std::partial_sum(in_offsets.begin(), in_offsets.end(), in_offsets.begin());
+    std::vector<uint32_t> in_edges(graph.GetEdgeCount());
+    {
+        std::vector<uint32_t> next(in_offsets.begin(), in_offsets.end() - 1);
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            in_edges[next[graph.GetEdge(edge_id).to]++] = static_cast<uint32_t>(edge_id);
+        }
+    }
+
+    // Vertices lying on many shortest paths cover most pairs and go first. Estimated
+    // by the number of descendants in shortest path trees from sample sources.
+    std::vector<size_t> importance(vertex_count, 0);
+    const size_t sample_step = std::max<size_t>(1, vertex_count / ORDER_SAMPLE_COUNT);
+    std::vector<size_t> descendants(vertex_count);
+    for (VertexId source = 0; source < vertex_count; source += sample_step) {
+        ShortestPathTree<Weight> tree(graph, source, [](const Edge<Weight>& edge) {
+            return edge.weight;
+        });
+        const auto& reached = tree.GetReached();
+        for (VertexId vertex : reached) {
+            descendants[vertex] = 1;
+        }
+        for (auto it = reached.rbegin(); it != reached.rend(); ++it) {
+            importance[*it] += descendants[*it];
+            if (const auto edge_id = tree.GetPrevEdge(*it)) {
+                descendants[graph.GetEdge(*edge_id).from] += descendants[*it];
+            }
+        }
+    }
+    std::vector<VertexId> order(vertex_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](VertexId lhs, VertexId rhs) {
+        return importance[lhs] > importance[rhs];
+    });
+
+    Labels forward(vertex_count);
+    Labels backward(vertex_count);
+    constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::infinity();
+    std::vector<Weight> hub_weights(vertex_count, INFINITE_WEIGHT); // by hub rank, labels of the current hub
+    std::vector<Weight> weights(vertex_count, INFINITE_WEIGHT);
+    std::vector<uint32_t> parents(vertex_count, NO_PARENT);
+    std::vector<VertexId> visited;
+    using QueueItem = std::pair<Weight, VertexId>;
+
+    // Dijkstra from the hub that stops at vertices already covered by earlier hubs
+    auto pruned_search = [&](uint32_t rank, bool is_forward) {
+        const VertexId hub = order[rank];
+        Labels& own_labels = is_forward ? forward : backward;
+        Labels& reached_labels = is_forward ? backward : forward;
+        for (const Entry& entry : own_labels[hub]) {
+            hub_weights[entry.hub] = entry.weight;
+        }
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        weights[hub] = Weight{};
+        visited.push_back(hub);
+        queue.push({Weight{}, hub});
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > weights[vertex]) {
+                continue;
+            }
+            bool covered = false;
+            for (const Entry& entry : reached_labels[vertex]) {
+                if (hub_weights[entry.hub] != INFINITE_WEIGHT && hub_weights[entry.hub] + entry.weight <= weight) {
+                    covered = true;
+                    break;
+                }
+            }
+            if (covered) {
+                continue;
+            }
+            reached_labels[vertex].push_back({rank, weight, parents[vertex]});
+            auto relax = [&](EdgeId edge_id, VertexId next) {
+                const auto& edge = graph.GetEdge(edge_id);
+                if (edge.weight < Weight{}) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                const Weight candidate = weight + edge.weight;
+                if (candidate < weights[next]) {
+                    if (weights[next] == INFINITE_WEIGHT) {
+                        visited.push_back(next);
+                    }
+                    weights[next] = candidate;
+                    parents[next] = static_cast<uint32_t>(edge_id);
+                    queue.push({candidate, next});
+                }
+            };
+            if (is_forward) {
+                for (EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                    relax(edge_id, graph.GetEdge(edge_id).to);
+                }
+            } else {
+                for (uint32_t i = in_offsets[vertex]; i < in_offsets[vertex + 1]; ++i) {
+                    relax(in_edges[i], graph.GetEdge(in_edges[i]).from);
+                }
+            }
+        }
+        for (VertexId vertex : visited) {
+            weights[vertex] = INFINITE_WEIGHT;
+            parents[vertex] = NO_PARENT;
+        }
+        visited.clear();
+        for (const Entry& entry : own_labels[hub]) {
+            hub_weights[entry.hub] = INFINITE_WEIGHT;
+        }
+    };
+
+    for (uint32_t rank = 0; rank < vertex_count; ++rank) {
+        pruned_search(rank, true);
+        pruned_search(rank, false);
+    }
+    forward_ = Pack(std::move(forward));
+    backward_ = Pack(std::move(backward));
+}
+
+template <typename Weight>
+HubLabels<Weight>::HubLabels(LabelSet forward, LabelSet backward)
+    : forward_(std::move(forward))
+    , backward_(std::move(backward)) {
+    for (const LabelSet* labels : {&forward_, &backward_}) {
+        if (labels->hubs.size() != labels->weights.size() || labels->hubs.size() != labels->parents.size()
+            || (!labels->offsets.empty() && labels->offsets.back() != labels->hubs.size())) {
+            throw std::invalid_argument("Hub labels are inconsistent");
+        }
+    }
+    if (forward_.offsets.size() != backward_.offsets.size()) {
+        throw std::invalid_argument("Hub labels are inconsistent");
+    }
+}
+
+template <typename Weight>
+bool HubLabels<Weight>::IsEmpty() const {
+    return forward_.offsets.empty();
+}
+
+template <typename Weight>
+size_t HubLabels<Weight>::GetEntryCount() const {
+    return forward_.hubs.size() + backward_.hubs.size();
+}
+
+template <typename Weight>
+const typename HubLabels<Weight>::LabelSet& HubLabels<Weight>::GetForwardLabels() const {
+    return forward_;
+}
+
+template <typename Weight>
+const typename HubLabels<Weight>::LabelSet& HubLabels<Weight>::GetBackwardLabels() const {
+    return backward_;
+}
+
+template <typename Weight>
+std::optional<std::pair<uint32_t, Weight>> HubLabels<Weight>::FindHub(VertexId from, VertexId to) const {
+    size_t i = forward_.offsets[from];
+    const size_t i_end = forward_.offsets[from + 1];
+    size_t j = backward_.offsets[to];
+    const size_t j_end = backward_.offsets[to + 1];
+    std::optional<std::pair<uint32_t, Weight>> best;
+    while (i < i_end && j < j_end) {
+        if (forward_.hubs[i] < backward_.hubs[j]) {
+            ++i;
+        } else if (backward_.hubs[j] < forward_.hubs[i]) {
+            ++j;
+        } else {
+            const Weight weight = forward_.weights[i] + backward_.weights[j];
+            // on a tie the hub of the lowest rank wins, which need not be the route the table keeps
+            if (!best || weight < best->second) {
+                best = {forward_.hubs[i], weight};
+            }
+            ++i;
+            ++j;
+        }
+    }
+    return best;
+}
+
+template <typename Weight>
+std::optional<Weight> HubLabels<Weight>::GetWeight(VertexId from, VertexId to) const {
+    if (const auto hub = FindHub(from, to)) {
+        return hub->second;
+    }
+    return std::nullopt;
+}
+
+template <typename Weight>
+std::optional<typename Router<Weight>::RouteInfo> HubLabels<Weight>::BuildRoute(const Graph& graph, VertexId from, VertexId to) const {
+    const auto hub = FindHub(from, to);
+    if (!hub) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (uint32_t parent = forward_.parents[FindEntry(forward_, from, hub->first)]; parent != NO_PARENT;) {
+        edges.push_back(parent);
+        parent = forward_.parents[FindEntry(forward_, graph.GetEdge(parent).to, hub->first)];
+    }
+    const size_t to_hub_count = edges.size();
+    for (uint32_t parent = backward_.parents[FindEntry(backward_, to, hub->first)]; parent != NO_PARENT;) {
+        edges.push_back(parent);
+        parent = backward_.parents[FindEntry(backward_, graph.GetEdge(parent).from, hub->first)];
+    }
+    std::reverse(edges.begin() + to_hub_count, edges.end());
+    // summed in travel order like a search would, the label sum may differ in rounding
+    Weight weight{};
+    for (EdgeId edge_id : edges) {
+        weight += graph.GetEdge(edge_id).weight;
+    }
+    return typename Router<Weight>::RouteInfo{weight, std::move(edges)};
+}
+
+template <typename Weight>
+size_t HubLabels<Weight>::FindEntry(const LabelSet& labels, VertexId vertex, uint32_t hub) {
+    const auto begin = labels.hubs.begin() + labels.offsets[vertex];
+    const auto end = labels.hubs.begin() + labels.offsets[vertex + 1];
+    const auto it = std::lower_bound(begin, end, hub);
+    if (it == end || *it != hub) {
+        throw std::logic_error("Hub label parent chain is broken");
+    }
+    return static_cast<size_t>(it - labels.hubs.begin());
+}
+
+template <typename Weight>
+typename HubLabels<Weight>::LabelSet HubLabels<Weight>::Pack(Labels labels) {
+    LabelSet result;
+    result.offsets.reserve(labels.size() + 1);
+    result.offsets.push_back(0);
+    for (const auto& label : labels) {
+        result.offsets.push_back(result.offsets.back() + static_cast<uint32_t>(label.size()));
+    }
+    result.hubs.reserve(result.offsets.back());
+    result.weights.reserve(result.offsets.back());
+    result.parents.reserve(result.offsets.back());
+    for (auto& label : labels) {
+        // hubs are added in rank order, so every label is already sorted
+        for (const Entry& entry : label) {
+            result.hubs.push_back(entry.hub);
+            result.weights.push_back(entry.weight);
+            result.parents.push_back(entry.parent);
+        }
+        std::vector<Entry>().swap(label);
+    }
+    return result;
+}
+
+}  // namespace graph
@@ -7,7 +7,7 @@ namespace json {
 namespace {
 using namespace std::literals;
 
-Node LoadNode(std::istream& input);
+Node LoadNode(std::istream& input, std::pmr::memory_resource* resource);
 Node LoadString(std::istream& input);
 
 std::string LoadLiteral(std::istream& input) {
@@ -18,14 +18,14 @@ std::string LoadLiteral(std::istream& input) {
     return s;
 }
 
-Node LoadArray(std::istream& input) {
-    std::vector<Node> result;
+Node LoadArray(std::istream& input, std::pmr::memory_resource* resource) {
+    Array result(resource);
 
     for (char c; input >> c && c != ']';) {
         if (c != ',') {
             input.putback(c);
         }
-        result.push_back(LoadNode(input));
+        result.push_back(LoadNode(input, resource));
     }
     if (!input) {
         throw ParsingError("Array parsing error"s);
@@ -33,8 +33,8 @@ Node LoadArray(std::istream& input) {
     return Node(std::move(result));
 }
 
-Node LoadDict(std::istream& input) {
-    Dict dict;
+Node LoadDict(std::istream& input, std::pmr::memory_resource* resource) {
+    Dict dict(resource);
 
     for (char c; input >> c && c != '}';) {
         if (c == '"') {
@@ -43,7 +43,7 @@ Node LoadDict(std::istream& input) {
                 if (dict.find(key) != dict.end()) {
                     throw ParsingError("Duplicate key '"s + key + "' have been found");
                 }
-                dict.emplace(std::move(key), LoadNode(input));
+                dict.emplace(std::move(key), LoadNode(input, resource));
             } else {
                 throw ParsingError(": is expected but '"s + c + "' has been found"s);
             }
@@ -190,16 +190,16 @@ Node LoadNumber(std::istream& input) {
     }
 }
 
-Node LoadNode(std::istream& input) {
+Node LoadNode(std::istream& input, std::pmr::memory_resource* resource) {
     char c;
     if (!(input >> c)) {
         throw ParsingError("Unexpected EOF"s);
     }
     switch (c) {
         case '[':
-            return LoadArray(input);
+            return LoadArray(input, resource);
         case '{':
-            return LoadDict(input);
+            return LoadDict(input, resource);
         case '"':
             return LoadString(input);
         case 't':
@@ -434,8 +434,8 @@ const Node& Document::GetRoot() const {
     return root_;
 }
 
-Document Load(std::istream& input) {
-    return Document{LoadNode(input)};
+Document Load(std::istream& input, std::pmr::memory_resource* resource) {
+    return Document{LoadNode(input, resource)};
 }
 
 void Print(const Document& doc, std::ostream& output) {
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <map>
+#include <memory_resource>
 #include <string>
 #include <variant>
 #include <vector>
@@ -9,8 +10,10 @@
 namespace json {
 
 class Node;
-using Dict = std::map<std::string, Node>;
-using Array = std::vector<Node>;
+// Containers take a memory resource, so a whole document can live in one arena;
+// strings keep the default allocator
+using Dict = std::pmr::map<std::string, Node>;
+using Array = std::pmr::vector<Node>;
 
 class ParsingError : public std::runtime_error {
 public:
@@ -71,7 +74,9 @@ inline bool operator!=(const Document& lhs, const Document& rhs) {
     return !(lhs == rhs);
 }
 
-Document Load(std::istream& input);
+// Arrays and dicts of the document are allocated from the resource, which has
+// to outlive the document and everything moved out of it
+Document Load(std::istream& input, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 void Print(const Document& doc, std::ostream& output);
 
@@ -1,24 +1,44 @@
 #include "json_reader.h"
+#include "catalogue_snapshot.h"
 #include "json_builder.h"
+#include "parallel.h"
+#include "profiler.h"
 
+#include <map>
+#include <memory_resource>
+#include <set>
 #include <sstream>
 #include <algorithm>
+#include <tuple>
 
 namespace transport {
 namespace io {
     
 JsonReader::JsonReader(TransportCatalogue& db, const RequestHandler& handler, renderer::MapRenderer& renderer, TransportRouter& router)
-    : db_(db), handler_(handler), renderer_(renderer), router_(router) {
+    : db_(db), handler_(handler), renderer_(renderer), router_(router)
+    , mutable_db_(&db), mutable_renderer_(&renderer), mutable_router_(&router)
+    , own_route_cache_(std::make_unique<RouteCache>()), route_cache_(*own_route_cache_) {
 }
 
-void JsonReader::ReadJsonFromStream(std::istream& input) {
-    requests_ = std::move(json::Document{json::Load(input)});
+JsonReader::JsonReader(const FrozenCatalogue& snapshot)
+    : db_(snapshot.GetCatalogue()), handler_(snapshot.GetHandler())
+    , renderer_(snapshot.GetRenderer()), router_(snapshot.GetRouter())
+    , route_cache_(snapshot.GetRouteCache()) {
+}
+
+void JsonReader::ReadJsonFromStream(std::istream& input, std::pmr::memory_resource* resource) {
+    requests_ = std::move(json::Document{json::Load(input, resource)});
+}
+
+void JsonReader::SetRequests(json::Document requests) {
+    requests_ = std::move(requests);
 }
     
 void JsonReader::FillDB() {
     if (requests_.GetRoot().AsDict().count("base_requests") == 0) {
         return;
     }
+    TransportCatalogue& db = GetMutable(mutable_db_);
     const json::Array& base_requests = requests_.GetRoot().AsDict().at("base_requests").AsArray();
     json::Array stop_requests;
     json::Array bus_requests;
@@ -32,7 +52,7 @@ void JsonReader::FillDB() {
     }
     
     for(auto& request: stop_requests) {
-        db_.AddStop(request.AsDict().at("name").AsString(),
+        db.AddStop(request.AsDict().at("name").AsString(),
                     {request.AsDict().at("latitude").AsDouble(),
                      request.AsDict().at("longitude").AsDouble()});
     }
@@ -40,23 +60,130 @@ void JsonReader::FillDB() {
         for(auto& [to_name, dist]: request.AsDict().at("road_distances").AsDict()) {
             const Stop* from = db_.FindStop(request.AsDict().at("name").AsString());
             const Stop* to = db_.FindStop(to_name);
-            db_.SetDistance(from, to, dist.AsInt());
+            db.SetDistance(from, to, dist.AsInt());
         }
     }
     for(auto& request: bus_requests) {
-        bool looped_flag = request.AsDict().at("is_roundtrip").AsBool();
-        std::vector<std::string_view> stop_names;
-        for(auto& stop: request.AsDict().at("stops").AsArray()) {
-            stop_names.push_back(stop.AsString());
+        AddBus(request.AsDict());
+    }
+    db.RebuildDerivedData();
+    db.BuildNameIndex();
+    db.BuildStopBusIndex();
+}
+
+void JsonReader::AddBus(const json::Dict& request) {
+    bool looped_flag = request.at("is_roundtrip").AsBool();
+    std::vector<std::string_view> stop_names;
+    for(auto& stop: request.at("stops").AsArray()) {
+        stop_names.push_back(stop.AsString());
+    }
+    GetMutable(mutable_db_).AddBus(request.at("name").AsString(), stop_names, looped_flag);
+}
+
+std::optional<std::string> JsonReader::GetPreviousBaseFile() const {
+    if (requests_.GetRoot().AsDict().count("base_update") == 0) {
+        return std::nullopt;
+    }
+    return requests_.GetRoot().AsDict().at("base_update").AsDict().at("file").AsString();
+}
+
+void JsonReader::ApplyBaseUpdate(const FrozenCatalogue& previous) {
+    TransportCatalogue& db = GetMutable(mutable_db_);
+    const json::Dict& update = requests_.GetRoot().AsDict().at("base_update").AsDict();
+    const TransportCatalogue& previous_db = previous.GetCatalogue();
+
+    // stops keep their ids, so graph vertices keep their order
+    for (const Stop& stop : previous_db.GetStops()) {
+        db.AddStop(stop.name, stop.coordinates);
+    }
+    std::vector<std::tuple<const Stop*, const Stop*, int>> distance_changes;
+    if (update.count("road_distances") != 0) {
+        for (const auto& node : update.at("road_distances").AsArray()) {
+            const json::Dict& change = node.AsDict();
+            const Stop* from = db_.FindStop(change.at("from").AsString());
+            const Stop* to = db_.FindStop(change.at("to").AsString());
+            if (from == nullptr || to == nullptr) {
+                std::cerr << "Unknown stop in road distance from " << change.at("from").AsString()
+                          << " to " << change.at("to").AsString() << ", skipped" << std::endl;
+                continue;
+            }
+            distance_changes.emplace_back(from, to, change.at("distance").AsInt());
+        }
+    }
+    // every direction is set once, as in a full rebuild: a changed distance
+    // replaces the old one instead of being set over it
+    std::map<std::pair<size_t, size_t>, int> distances;
+    for (const auto& [stops, distance] : previous_db.GetDistances()) {
+        distances[{stops.first->id, stops.second->id}] = distance;
+    }
+    std::set<std::pair<size_t, size_t>> changed;
+    for (const auto& [from, to, distance] : distance_changes) {
+        distances[{from->id, to->id}] = distance;
+        changed.insert({from->id, to->id});
+    }
+    if (previous_db.HasMirroredDistances()) {
+        // older bases store every reverse too, whether it was given or copied
+        for (const auto& [from, to, distance] : distance_changes) {
+            auto backward = distances.find({to->id, from->id});
+            if (backward != distances.end() && changed.count(backward->first) == 0) {
+                std::cerr << "The base stores road distances both ways, the distance from " << to->name
+                          << " to " << from->name << " stays " << backward->second
+                          << ", list it in road_distances to change it too" << std::endl;
+            }
         }
-        if (looped_flag == false) {
-            std::vector<std::string_view> tmp(stop_names.rbegin() + 1, stop_names.rend());
-            for(auto& s: tmp) {
-                stop_names.push_back(s);
+    }
+    for (const auto& [stops, distance] : distances) {
+        db.SetDistance(db.GetStopById(stops.first), db.GetStopById(stops.second), distance);
+    }
+
+    // changed buses go to the end like in base_requests with the old entry
+    // removed and the new one appended
+    std::unordered_set<std::string_view> removed;
+    if (update.count("remove_buses") != 0) {
+        for (const auto& node : update.at("remove_buses").AsArray()) {
+            if (previous_db.FindBus(node.AsString()) == nullptr) {
+                std::cerr << "Bus " << node.AsString() << " to remove not found" << std::endl;
+            }
+            removed.insert(node.AsString());
+        }
+    }
+    // a bus added under the name of an existing one replaces it
+    std::vector<const json::Dict*> added_buses;
+    if (update.count("add_buses") != 0) {
+        std::unordered_set<std::string_view> added;
+        for (const auto& node : update.at("add_buses").AsArray()) {
+            const std::string& name = node.AsDict().at("name").AsString();
+            if (!added.insert(name).second) {
+                std::cerr << "Bus " << name << " is added more than once, the first one is kept" << std::endl;
+                continue;
             }
+            removed.insert(name);
+            added_buses.push_back(&node.AsDict());
         }
-        db_.AddBus(request.AsDict().at("name").AsString(), stop_names, looped_flag);
     }
+    for (const Bus& bus : previous_db.GetBuses()) {
+        if (removed.count(bus.name) != 0) {
+            continue;
+        }
+        std::vector<std::string_view> stop_names;
+        stop_names.reserve(bus.stops.size());
+        for (const Stop* stop : bus.stops) {
+            stop_names.push_back(stop->name);
+        }
+        db.AddBus(bus.name, stop_names, bus.is_roundtrip);
+    }
+    for (const json::Dict* request : added_buses) {
+        AddBus(*request);
+    }
+    db.RebuildDerivedData();
+    db.BuildNameIndex();
+    db.BuildStopBusIndex();
+
+    GetMutable(mutable_renderer_).ApplySettings(previous.GetRenderer().GetSettings());
+    const TransportRouter& previous_router = previous.GetRouter();
+    TransportRouter& router = GetMutable(mutable_router_);
+    router.ApplySettings(previous_router.GetSettings());
+    router.SetBackend(previous_router.GetBackend(), previous_router.GetLandmarkCount());
 }
 
 void JsonReader::ProcessAndApplyRenderSettings() {
@@ -81,7 +208,7 @@ void JsonReader::ProcessAndApplyRenderSettings() {
         color_palette.push_back(GetColorFromJsonNode(val));
     }
     
-    renderer_.ApplySettings({
+    GetMutable(mutable_renderer_).ApplySettings({
         width, height, padding, line_width, stop_radius, bus_label_font_size,
         {bus_label_offset[0].AsDouble(), bus_label_offset[1].AsDouble()},
         stop_label_font_size,
@@ -97,39 +224,184 @@ void JsonReader::ProcessAndApplyRouterSettings() {
     auto& s = requests_.GetRoot().AsDict().at("routing_settings").AsDict();
     size_t bus_wait_time = s.at("bus_wait_time").AsInt();
     double bus_velocity = s.at("bus_velocity").AsDouble();
-    router_.ApplySettings({bus_wait_time, bus_velocity});
+    GetMutable(mutable_router_).ApplySettings({bus_wait_time, bus_velocity});
+    if (s.count("backend") != 0) {
+        const std::string& backend = s.at("backend").AsString();
+        size_t landmark_count = TransportRouter::DEFAULT_LANDMARK_COUNT;
+        if (s.count("landmark_count") != 0) {
+            landmark_count = static_cast<size_t>(std::max(1, s.at("landmark_count").AsInt()));
+        }
+        if (backend == "alt") {
+            GetMutable(mutable_router_).SetBackend(RoutingBackend::ALT, landmark_count);
+        } else if (backend == "hub_labels") {
+            GetMutable(mutable_router_).SetBackend(RoutingBackend::HUB_LABELS);
+        } else if (backend == "raptor") {
+            GetMutable(mutable_router_).SetBackend(RoutingBackend::RAPTOR);
+        } else if (backend != "table") {
+            std::cerr << "Unknown routing backend " << backend << ", using table" << std::endl;
+        }
+    }
 }
 
 json::Dict JsonReader::ProcessSerializationSettings() const {
     if (requests_.GetRoot().AsDict().count("serialization_settings") == 0) {
-        return json::Builder{}.StartDict().Key("file").Value("").EndDict().Build().AsDict();
+        return json::Builder{}.StartDict()
+            .Key("file").Value("")
+            .Key("omit_derived").Value(false)
+            .EndDict().Build().AsDict();
     }
     const auto& s = requests_.GetRoot().AsDict().at("serialization_settings").AsDict();
     std::string file = s.at("file").AsString();
+    bool omit_derived = false;
+    if (s.count("omit_derived") != 0) {
+        omit_derived = s.at("omit_derived").AsBool();
+    }
     return json::Builder{}
             .StartDict()
                 .Key("file").Value(file)
+                .Key("omit_derived").Value(omit_derived)
             .EndDict().Build().AsDict();
 }
 
+std::optional<json::Dict> JsonReader::ProcessProfilingSettings() const {
+    if (requests_.GetRoot().AsDict().count("profiling_settings") == 0) {
+        return std::nullopt;
+    }
+    const auto& s = requests_.GetRoot().AsDict().at("profiling_settings").AsDict();
+    std::string report_file = "";
+    std::string trace_file = "";
+    double slow_request_ms = 0.0;
+    if (s.count("report_file") != 0) {
+        report_file = s.at("report_file").AsString();
+    }
+    if (s.count("trace_file") != 0) {
+        trace_file = s.at("trace_file").AsString();
+    }
+    if (s.count("slow_request_ms") != 0) {
+        slow_request_ms = s.at("slow_request_ms").AsDouble();
+    }
+    return json::Builder{}
+            .StartDict()
+                .Key("report_file").Value(report_file)
+                .Key("trace_file").Value(trace_file)
+                .Key("slow_request_ms").Value(slow_request_ms)
+            .EndDict().Build().AsDict();
+}
+
+namespace {
+
+// one-line "key=value" rendering of request parameters for the slow request log
+std::string FormatRequestParameters(const json::Dict& request) {
+    std::ostringstream out;
+    bool first = true;
+    for (const auto& [key, value] : request) {
+        if (key == "id" || key == "type") {
+            continue;
+        }
+        if (!first) {
+            out << ", ";
+        }
+        first = false;
+        out << key << "=";
+        if (value.IsString()) {
+            out << '"' << value.AsString() << '"';
+        } else if (value.IsInt() || value.IsPureDouble() || value.IsBool()) {
+            json::Print(json::Document{value}, out);
+        } else {
+            out << "...";
+        }
+    }
+    return out.str();
+}
+
+} // namespace
+
 void JsonReader::ProcessStatRequests(std::ostream& output) {
     if (requests_.GetRoot().AsDict().count("stat_requests") == 0) {
         return;
     }
+    profile::Profiler& profiler = profile::GetProfiler();
+    double slow_request_ms = 0.0;
+    if (auto settings = ProcessProfilingSettings()) {
+        slow_request_ms = settings->at("slow_request_ms").AsDouble();
+    }
+    const json::Array& stat_requests = requests_.GetRoot().AsDict().at("stat_requests").AsArray();
+    PlanRouteRequests(stat_requests);
     json::Array result;
-    for(auto& request: requests_.GetRoot().AsDict().at("stat_requests").AsArray()) {
-        if (request.AsDict().at("type").AsString() == "Stop") { // Stop info requests
+    for(auto& request: stat_requests) {
+        const std::string& type = request.AsDict().at("type").AsString();
+        auto start = profile::Clock::now();
+        if (type == "Stop") { // Stop info requests
             result.emplace_back(std::move(json::Node{ProcessStopInfoRequest(request.AsDict())}));
-        } else if (request.AsDict().at("type").AsString() == "Bus") {
+        } else if (type == "Bus") {
             result.emplace_back(std::move(json::Node{ProcessBusInfoRequest(request.AsDict())}));
-        } else if (request.AsDict().at("type").AsString() == "Map") {
+        } else if (type == "Map") {
             result.emplace_back(std::move(json::Node{ProcessMapRequest(request.AsDict())}));
-        } else /*if (request_.AsDict().at("type").AsString() == "Route")*/ {
+        } else if (type == "Isochrone") {
+            result.emplace_back(std::move(json::Node{ProcessIsochroneRequest(request.AsDict())}));
+        } else if (type == "DirectBuses") {
+            result.emplace_back(std::move(json::Node{ProcessDirectBusesRequest(request.AsDict())}));
+        } else if (type == "DirectStops") {
+            result.emplace_back(std::move(json::Node{ProcessDirectStopsRequest(request.AsDict())}));
+        } else if (type == "LatencyStats") {
+            result.emplace_back(std::move(json::Node{ProcessLatencyStatsRequest(request.AsDict())}));
+        } else /*if (type == "Route")*/ {
             result.emplace_back(std::move(json::Node{ProcessRouteRequest(request.AsDict())}));
         }
+        auto finish = profile::Clock::now();
+
+        uint64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+        if (auto planned = planned_routes_.find(&request.AsDict()); planned != planned_routes_.end()) {
+            // the search ran in PlanRouteRequests, here the answer was only copied
+            duration_ns += planned->second.search_ns;
+        }
+        auto it = latencies_->find(type);
+        if (it == latencies_->end()) {
+            it = latencies_->emplace(type, profile::LatencyHistogram{}).first;
+        }
+        it->second.Record(duration_ns);
+        if (profiler.IsEnabled()) {
+            profiler.RecordPhase("stat_request:" + type, "stat_request", start, finish, false);
+        }
+        if (slow_request_ms > 0 && duration_ns > slow_request_ms * 1e6) {
+            std::cerr << "Slow request: id " << request.AsDict().at("id").AsInt()
+                      << ", type " << type << ", " << duration_ns / 1e6 << " ms ("
+                      << FormatRequestParameters(request.AsDict()) << ")" << std::endl;
+        }
     }
+    planned_routes_.clear();
+    profiler.SetReportSection("stat_request_latency", BuildLatencyReport());
     json::Print(json::Document{result}, output);
 }
+
+void JsonReader::RejectStatRequests(std::ostream& output, std::string_view message) const {
+    json::Array result;
+    if (requests_.GetRoot().AsDict().count("stat_requests") != 0) {
+        for (const auto& request : requests_.GetRoot().AsDict().at("stat_requests").AsArray()) {
+            result.emplace_back(json::Builder{}
+            .StartDict()
+                .Key("request_id").Value(request.AsDict().at("id").AsInt())
+                .Key("error_message").Value(std::string(message))
+            .EndDict().Build());
+        }
+    }
+    json::Print(json::Document{result}, output);
+}
+
+void JsonReader::SetLatencyHistograms(profile::LatencyHistograms& latencies) {
+    latencies_ = &latencies;
+}
+
+json::Node JsonReader::BuildLatencyReport() const {
+    json::Dict report;
+    profile::LatencyHistogram total;
+    for (const auto& [type, histogram] : *latencies_) {
+        report[type] = histogram.BuildReport();
+        total.Merge(histogram);
+    }
+    report["all"] = total.BuildReport();
+    return report;
+}
     
 json::Dict JsonReader::ProcessStopInfoRequest(const json::Dict& request) const {
     int id = request.at("id").AsInt();
@@ -202,7 +474,9 @@ json::Dict JsonReader::ProcessBusInfoRequest(const json::Dict& request) const {
     
 json::Dict JsonReader::ProcessMapRequest(const json::Dict& request) const {
     int id = request.at("id").AsInt();
-    auto res = handler_.RenderMap();
+    // the document is dropped right after rendering, so its objects go to an arena
+    std::pmr::monotonic_buffer_resource arena;
+    auto res = handler_.RenderMap(&arena);
     std::ostringstream out;
     res.Render(out);
     return json::Builder{}
@@ -212,40 +486,278 @@ json::Dict JsonReader::ProcessMapRequest(const json::Dict& request) const {
     .EndDict().Build().AsDict();
 }
     
+json::Dict JsonReader::ProcessDirectBusesRequest(const json::Dict& request) const {
+    int id = request.at("id").AsInt();
+    auto res = handler_.GetDirectBuses(request.at("from").AsString(), request.at("to").AsString());
+    if (!res) {
+        return json::Builder{}
+            .StartDict()
+                .Key("request_id").Value(id)
+                .Key("error_message").Value("not found")
+            .EndDict().Build().AsDict();
+    }
+    json::Array buses;
+    buses.reserve(res->size());
+    for (std::string_view name : *res) {
+        buses.emplace_back(std::string(name));
+    }
+    return json::Builder{}.StartDict()
+        .Key("request_id").Value(id)
+        .Key("buses").Value(std::move(buses))
+        .EndDict().Build().AsDict();
+}
+
+json::Dict JsonReader::ProcessDirectStopsRequest(const json::Dict& request) const {
+    int id = request.at("id").AsInt();
+    auto res = handler_.GetDirectStops(request.at("from").AsString());
+    if (!res) {
+        return json::Builder{}
+            .StartDict()
+                .Key("request_id").Value(id)
+                .Key("error_message").Value("not found")
+            .EndDict().Build().AsDict();
+    }
+    json::Array stops;
+    stops.reserve(res->size());
+    for (std::string_view name : *res) {
+        stops.emplace_back(std::string(name));
+    }
+    return json::Builder{}.StartDict()
+        .Key("request_id").Value(id)
+        .Key("stops").Value(std::move(stops))
+        .EndDict().Build().AsDict();
+}
+    
+json::Array JsonReader::BuildRouteItems(const Journey& journey) const {
+    json::Array items;
+    for (const RouteLeg& leg : journey.legs) {
+        items.emplace_back(json::Builder{}.StartDict()
+                                .Key("type").Value("Wait")
+                                .Key("stop_name").Value(std::string(leg.stop->name))
+                                .Key("time").Value(static_cast<int>(leg.wait_time))
+                                .EndDict().Build());
+        items.emplace_back(json::Builder{}.StartDict()
+                                .Key("type").Value("Bus")
+                                .Key("bus").Value(std::string(leg.bus->name))
+                                .Key("span_count").Value(leg.span_count)
+                                .Key("time").Value(leg.bus_time)
+                                .EndDict().Build());
+    }
+    return items;
+}
+
+json::Dict JsonReader::BuildRouteResponse(const std::optional<Journey>& journey) const {
+    if (!journey) {
+        return json::Builder{}
+            .StartDict()
+                .Key("error_message").Value("not found")
+            .EndDict().Build().AsDict();
+    }
+    // if there are no items, out items = [] and time = 0
+    return json::Builder{}.StartDict()
+        .Key("total_time").Value(journey->total_time)
+        .Key("items").Value(BuildRouteItems(*journey))
+        .EndDict().Build().AsDict();
+}
+
+void JsonReader::PlanRouteRequests(const json::Array& requests) {
+    planned_routes_.clear();
+    // from_id, to_id, bus_wait_time, bus_velocity
+    using PairKey = std::tuple<size_t, size_t, size_t, double>;
+    struct Answer {
+        RouteCache::Value value;
+        size_t request_count = 0;
+        uint64_t search_ns = 0; // per request
+    };
+    std::map<PairKey, Answer> answers;
+    std::vector<std::pair<const json::Dict*, PairKey>> planned;
+    for (const auto& node : requests) {
+        const json::Dict& request = node.AsDict();
+        if (request.at("type").AsString() != "Route"
+            || (request.count("pareto") != 0 && request.at("pareto").AsBool())) {
+            continue;
+        }
+        auto settings = GetRequestRouterSettings(request);
+        const Stop* from = db_.FindStop(request.at("from").AsString());
+        const Stop* to = db_.FindStop(request.at("to").AsString());
+        if (!settings || from == nullptr || to == nullptr) {
+            continue;
+        }
+        PairKey key{from->id, to->id, settings->bus_wait_time, settings->bus_velocity};
+        ++answers[key].request_count;
+        planned.push_back({&request, key});
+    }
+    if (planned.size() < 2) {
+        return;
+    }
+    profile::ScopedPhase phase("plan_routes");
+    profile::Profiler& profiler = profile::GetProfiler();
+    const RouterSettings default_settings = router_.GetSettings();
+    auto is_default = [&default_settings](const PairKey& key) {
+        return std::get<2>(key) == default_settings.bus_wait_time && std::get<3>(key) == default_settings.bus_velocity;
+    };
+
+    struct Group {
+        const Stop* from;
+        RouterSettings settings;
+        std::vector<std::map<PairKey, Answer>::iterator> pairs;
+    };
+    std::vector<Group> groups;
+    std::map<std::tuple<size_t, size_t, double>, size_t> group_indexes;
+    for (auto it = answers.begin(); it != answers.end(); ++it) {
+        const auto& [from_id, to_id, bus_wait_time, bus_velocity] = it->first;
+        if (is_default(it->first)) {
+            it->second.value = route_cache_.Find(from_id, to_id);
+            if (it->second.value) {
+                profiler.AddCounter("route_cache_hits", 1);
+                continue;
+            }
+            profiler.AddCounter("route_cache_misses", 1);
+        }
+        auto [group, inserted] = group_indexes.emplace(std::make_tuple(from_id, bus_wait_time, bus_velocity), groups.size());
+        if (inserted) {
+            groups.push_back({db_.GetStopById(from_id), {bus_wait_time, bus_velocity}, {}});
+        }
+        groups[group->second].pairs.push_back(it);
+    }
+
+    // every group writes only to its own answers; the search time is split
+    // evenly between the requests it answers
+    parallel::ForEachChunk(groups.size(), parallel::GetThreadCount(groups.size(), 1), [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            const Group& group = groups[i];
+            auto start = profile::Clock::now();
+            std::vector<std::string_view> to;
+            to.reserve(group.pairs.size());
+            size_t request_count = 0;
+            for (const auto& pair : group.pairs) {
+                to.push_back(db_.GetStopById(std::get<1>(pair->first))->name);
+                request_count += pair->second.request_count;
+            }
+            auto journeys = router_.FindJourneysFrom(group.from->name, to, group.settings);
+            for (size_t j = 0; j < group.pairs.size(); ++j) {
+                group.pairs[j]->second.value = std::make_shared<const json::Dict>(BuildRouteResponse(journeys[j]));
+            }
+            const uint64_t search_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(profile::Clock::now() - start).count();
+            for (const auto& pair : group.pairs) {
+                pair->second.search_ns = search_ns / request_count;
+            }
+        }
+    });
+    for (const Group& group : groups) {
+        for (const auto& pair : group.pairs) {
+            if (is_default(pair->first)) {
+                route_cache_.Insert(std::get<0>(pair->first), std::get<1>(pair->first), pair->second.value);
+            }
+        }
+    }
+
+    for (const auto& [request, key] : planned) {
+        const Answer& answer = answers.at(key);
+        planned_routes_.emplace(request, PlannedRoute{answer.value, answer.search_ns});
+    }
+    profiler.AddCounter("route_plan_searches", static_cast<int64_t>(groups.size()));
+    profiler.AddCounter("route_plan_duplicates", static_cast<int64_t>(planned.size() - answers.size()));
+}
+
 json::Dict JsonReader::ProcessRouteRequest(const json::Dict& request) const {
     int id = request.at("id").AsInt();
-    auto res = router_.BuildRoute(request.at("from").AsString(), request.at("to").AsString());
-    if (res) {
-        // unpack result; if there are no items, out items = [] and time = 0
-        json::Array items;
-        for(size_t edge_id: res->edges) {
-            const auto& edge = router_.GetEdge(edge_id);
-            items.emplace_back(std::move(json::Builder{}.StartDict()
-                                        .Key("type").Value("Wait")
-                                        .Key("stop_name").Value(db_.GetStopById(edge.from)->name)
-                                        .Key("time").Value(router_.GetBusWaitTime())
-                                        .EndDict().Build().AsDict()));
-            std::string bus_name = db_.GetBusById(edge.bus_id)->name;
-            items.emplace_back(std::move(json::Builder{}.StartDict()
-                                        .Key("type").Value("Bus")
-                                        .Key("bus").Value(std::string(bus_name))
-                                        .Key("span_count").Value(static_cast<int>(edge.stop_count))
-                                        .Key("time").Value(edge.weight - router_.GetBusWaitTime())
-                                        .EndDict().Build().AsDict()));
-        }
-        
-        return json::Builder{}.StartDict()
-            .Key("request_id").Value(id)
-            .Key("total_time").Value(res->weight)
-            .Key("items").Value(items)
+    auto settings = GetRequestRouterSettings(request);
+    if (!settings) {
+        return json::Builder{}
+            .StartDict()
+                .Key("request_id").Value(id)
+                .Key("error_message").Value("invalid routing settings")
             .EndDict().Build().AsDict();
+    }
+    const std::string& from = request.at("from").AsString();
+    const std::string& to = request.at("to").AsString();
+
+    // only answers with the snapshot settings are cached
+    const RouterSettings& default_settings = router_.GetSettings();
+    const Stop* from_stop = db_.FindStop(from);
+    const Stop* to_stop = db_.FindStop(to);
+    const bool cacheable = from_stop != nullptr && to_stop != nullptr
+        && settings->bus_wait_time == default_settings.bus_wait_time
+        && settings->bus_velocity == default_settings.bus_velocity;
+    json::Dict result;
+    if (auto planned = planned_routes_.find(&request); planned != planned_routes_.end()) {
+        result = *planned->second.answer;
+    } else if (cacheable) {
+        RouteCache::Value cached = route_cache_.Find(from_stop->id, to_stop->id);
+        if (cached) {
+            profile::GetProfiler().AddCounter("route_cache_hits", 1);
+        } else {
+            profile::GetProfiler().AddCounter("route_cache_misses", 1);
+            cached = std::make_shared<const json::Dict>(BuildRouteResponse(router_.FindJourney(from, to, *settings)));
+            route_cache_.Insert(from_stop->id, to_stop->id, cached);
+        }
+        result = *cached;
     } else {
+        result = BuildRouteResponse(router_.FindJourney(from, to, *settings));
+    }
+    result["request_id"] = id;
+
+    if (result.count("error_message") == 0 && request.count("pareto") != 0 && request.at("pareto").AsBool()) {
+        json::Array pareto;
+        const auto journeys = router_.FindJourneys(from, to, *settings);
+        for (const Journey& journey : *journeys) {
+            pareto.emplace_back(json::Builder{}.StartDict()
+                .Key("rides").Value(static_cast<int>(journey.legs.size()))
+                .Key("total_time").Value(journey.total_time)
+                .Key("items").Value(BuildRouteItems(journey))
+                .EndDict().Build());
+        }
+        result["pareto"] = std::move(pareto);
+    }
+    return result;
+}
+
+json::Dict JsonReader::ProcessIsochroneRequest(const json::Dict& request) const {
+    int id = request.at("id").AsInt();
+    auto settings = GetRequestRouterSettings(request);
+    if (!settings) {
+        return json::Builder{}
+            .StartDict()
+                .Key("request_id").Value(id)
+                .Key("error_message").Value("invalid routing settings")
+            .EndDict().Build().AsDict();
+    }
+    auto reachable = router_.FindReachable(request.at("from").AsString(), request.at("max_time").AsDouble(), *settings);
+    if (!reachable) {
         return json::Builder{}
             .StartDict()
                 .Key("request_id").Value(id)
                 .Key("error_message").Value("not found")
             .EndDict().Build().AsDict();
     }
+    if (request.count("sort") != 0 && request.at("sort").AsBool()) {
+        std::stable_sort(reachable->begin(), reachable->end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second < rhs.second;
+        });
+    }
+    json::Array stops;
+    json::Array times;
+    stops.reserve(reachable->size());
+    times.reserve(reachable->size());
+    for (const auto& [stop_id, time] : *reachable) {
+        stops.emplace_back(std::string(db_.GetStopById(stop_id)->name));
+        times.emplace_back(time);
+    }
+    return json::Builder{}.StartDict()
+        .Key("request_id").Value(id)
+        .Key("stops").Value(std::move(stops))
+        .Key("times").Value(std::move(times))
+        .EndDict().Build().AsDict();
+}
+    
+json::Dict JsonReader::ProcessLatencyStatsRequest(const json::Dict& request) const {
+    int id = request.at("id").AsInt();
+    return json::Builder{}
+        .StartDict()
+            .Key("request_id").Value(id)
+            .Key("latency").Value(BuildLatencyReport().AsDict())
+        .EndDict().Build().AsDict();
 }
     
 svg::Color JsonReader::GetColorFromJsonNode(const json::Node& node) const {
@@ -263,6 +775,23 @@ svg::Color JsonReader::GetColorFromJsonNode(const json::Node& node) const {
     }
 }
 
+std::optional<RouterSettings> JsonReader::GetRequestRouterSettings(const json::Dict& request) const {
+    RouterSettings settings = router_.GetSettings();
+    if (request.count("bus_wait_time") != 0) {
+        int bus_wait_time = request.at("bus_wait_time").AsInt();
+        if (bus_wait_time < 0) {
+            return std::nullopt;
+        }
+        settings.bus_wait_time = static_cast<size_t>(bus_wait_time);
+    }
+    if (request.count("bus_velocity") != 0) {
+        settings.bus_velocity = request.at("bus_velocity").AsDouble();
+        if (!(settings.bus_velocity > 0)) {
+            return std::nullopt;
+        }
+    }
+    return settings;
+}
     
 } // end namespace io
 } // end namespace transport
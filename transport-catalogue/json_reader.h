@@ -1,41 +1,105 @@
 #pragma once
 
 #include <iostream>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "geo.h"
 #include "json.h"
+#include "latency_histogram.h"
 #include "request_handler.h"
+#include "route_cache.h"
 #include "transport_router.h"
 
 namespace transport {
+
+class FrozenCatalogue;
+
 namespace io {
     
 class JsonReader {
 public:
     JsonReader(TransportCatalogue& db, const RequestHandler& handler, renderer::MapRenderer& renderer, TransportRouter& router);
-    void ReadJsonFromStream(std::istream& input);
+    // Read-only reader: answers stat requests, FillDB and Apply* methods throw
+    explicit JsonReader(const FrozenCatalogue& snapshot);
+    // Containers of the parsed document are allocated from the resource
+    void ReadJsonFromStream(std::istream& input, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    void SetRequests(json::Document requests);
     void FillDB();
+    // Snapshot named by base_update.file, nullopt for a full make_base
+    std::optional<std::string> GetPreviousBaseFile() const;
+    // Fills the catalogue from the previous snapshot with the changes of base_update
+    // and takes its render and routing settings; the result is the catalogue
+    // make_base would build from the base_requests with the same changes
+    void ApplyBaseUpdate(const FrozenCatalogue& previous);
     void ProcessAndApplyRenderSettings();
     void ProcessAndApplyRouterSettings();
     json::Dict ProcessSerializationSettings() const;
+    std::optional<json::Dict> ProcessProfilingSettings() const;
     void ProcessStatRequests(std::ostream& output);
+    // Answers every stat request with the error message, for a document that can't be answered
+    void RejectStatRequests(std::ostream& output, std::string_view message) const;
+    // Latencies are recorded into the given histograms instead of the reader's own,
+    // so they can outlive the reader (serve mode answers every document by a new one)
+    void SetLatencyHistograms(profile::LatencyHistograms& latencies);
+    json::Node BuildLatencyReport() const;
     
 private:
     json::Document requests_ = json::Document{nullptr};
-    TransportCatalogue& db_;
+    const TransportCatalogue& db_;
     const RequestHandler& handler_;
-    renderer::MapRenderer& renderer_;
-    TransportRouter& router_;
+    const renderer::MapRenderer& renderer_;
+    const TransportRouter& router_;
+    TransportCatalogue* mutable_db_ = nullptr;
+    renderer::MapRenderer* mutable_renderer_ = nullptr;
+    TransportRouter* mutable_router_ = nullptr;
+    std::unique_ptr<RouteCache> own_route_cache_;
+    RouteCache& route_cache_;
+    profile::LatencyHistograms own_latencies_;
+    profile::LatencyHistograms* latencies_ = &own_latencies_;
+    struct PlannedRoute {
+        RouteCache::Value answer;
+        uint64_t search_ns; // share of the search that found it, charged to the request's latency
+    };
+    // Answers of the current batch's Route requests found by PlanRouteRequests
+    std::unordered_map<const json::Dict*, PlannedRoute> planned_routes_;
     
+    void AddBus(const json::Dict& request);
     json::Dict ProcessStopInfoRequest(const json::Dict& query) const;
     json::Dict ProcessBusInfoRequest(const json::Dict& query) const;
     json::Dict ProcessMapRequest(const json::Dict& query) const;
+    json::Dict ProcessDirectBusesRequest(const json::Dict& query) const;
+    json::Dict ProcessDirectStopsRequest(const json::Dict& query) const;
     json::Dict ProcessRouteRequest(const json::Dict& query) const;
+    // Total time and items of the route, error_message if there is none
+    json::Dict BuildRouteResponse(const std::optional<Journey>& journey) const;
+    // Answers all Route requests of a batch ahead: identical ones once, the ones from
+    // the same stop with the same settings by one search, groups in parallel
+    void PlanRouteRequests(const json::Array& requests);
+    json::Array BuildRouteItems(const Journey& journey) const;
+    json::Dict ProcessIsochroneRequest(const json::Dict& query) const;
+    json::Dict ProcessLatencyStatsRequest(const json::Dict& query) const;
     svg::Color GetColorFromJsonNode(const json::Node& node) const;
+    // Snapshot settings with bus_wait_time and bus_velocity of the request applied, nullopt if invalid
+    std::optional<RouterSettings> GetRequestRouterSettings(const json::Dict& query) const;
+    template <typename T>
+    static T& GetMutable(T* ptr);
 };
     
+template <typename T>
+T& JsonReader::GetMutable(T* ptr) {
+    if (ptr == nullptr) {
+        throw std::logic_error("JsonReader is read-only");
+    }
+    return *ptr;
+}
+    
 } // end namespace io
 } // end namespace transport
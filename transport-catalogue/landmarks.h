@@ -0,0 +1,308 @@
+#pragma once
+
+#include "dijkstra.h"
+#include "graph.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Distances from and to a few landmark vertices. By the triangle inequality they
+// give a lower bound of the distance between any two vertices, which guides the
+// A* search of LandmarkPath (ALT). Memory is linear in the vertex count.
+template <typename Weight>
+class Landmarks {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    Landmarks() = default;
+    // Up to landmark_count landmarks: first one per weakly connected component,
+    // largest first, then each next one is the vertex farthest from those chosen
+    Landmarks(const Graph& graph, const std::vector<size_t>& components, size_t landmark_count);
+    // Distances are vertex-major: vertices.size() values per graph vertex
+    Landmarks(std::vector<VertexId> vertices, std::vector<Weight> from_landmarks, std::vector<Weight> to_landmarks);
+
+    bool IsEmpty() const;
+    const std::vector<VertexId>& GetVertices() const;
+    const std::vector<Weight>& GetFromLandmarks() const;
+    const std::vector<Weight>& GetToLandmarks() const;
+    // Lower bound of the distance from `from` to `to`, infinity if there is no path
+    Weight GetLowerBound(VertexId from, VertexId to) const;
+
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::infinity();
+
+private:
+    std::vector<VertexId> vertices_;
+    std::vector<Weight> from_landmarks_; // [vertex * count + i] = distance from landmark i to vertex
+    std::vector<Weight> to_landmarks_; // [vertex * count + i] = distance from vertex to landmark i
+};
+
+// A* search of one shortest path with the landmark lower bounds as potentials.
+// Settles far fewer vertices than ShortestPathTree with the same target.
+template <typename Weight>
+class LandmarkPath {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    LandmarkPath(const Graph& graph, const Landmarks<Weight>& landmarks, VertexId from, VertexId to);
+
+    bool IsFound() const;
+    Weight GetWeight() const;
+    // Edges of the path in travel order
+    std::vector<EdgeId> GetEdges() const;
+    size_t GetSettledCount() const;
+
+private:
+    const Graph& graph_;
+    VertexId to_;
+    std::vector<Weight> weights_;
+    std::vector<std::optional<EdgeId>> prev_edges_;
+    std::vector<bool> settled_;
+    size_t settled_count_ = 0;
+};
+
+template <typename Weight>
+Landmarks<Weight>::Landmarks(const Graph& graph, const std::vector<size_t>& components, size_t landmark_count) {
+    const size_t vertex_count = graph.GetVertexCount();
+    Graph reversed(vertex_count);
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        auto edge = graph.GetEdge(edge_id);
+        std::swap(edge.from, edge.to);
+        reversed.AddEdge(edge);
+    }
+    reversed.Finalize();
+    auto edge_weight = [](const Edge<Weight>& edge) {
+        return edge.weight;
+    };
+
+    std::vector<size_t> component_sizes;
+    for (size_t component : components) {
+        if (component >= component_sizes.size()) {
+            component_sizes.resize(component + 1, 0);
+        }
+        ++component_sizes[component];
+    }
+    std::vector<bool> covered(component_sizes.size(), false);
+    // sum of the distances to and from the nearest landmark of the component
+    std::vector<Weight> separation(vertex_count, INFINITE_WEIGHT);
+    std::vector<std::vector<Weight>> from_columns;
+    std::vector<std::vector<Weight>> to_columns;
+
+    while (vertices_.size() < landmark_count) {
+        std::optional<VertexId> landmark;
+        size_t uncovered = component_sizes.size();
+        for (size_t component = 0; component < component_sizes.size(); ++component) {
+            if (!covered[component] && component_sizes[component] > 1
+                && (uncovered == component_sizes.size() || component_sizes[component] > component_sizes[uncovered])) {
+                uncovered = component;
+            }
+        }
+        if (uncovered != component_sizes.size()) {
+            // the vertex farthest from an arbitrary one of the component
+            covered[uncovered] = true;
+            const VertexId start = static_cast<VertexId>(std::find(components.begin(), components.end(), uncovered)
+                                                         - components.begin());
+            ShortestPathTree<Weight> tree(graph, start, edge_weight);
+            landmark = tree.GetReached().back();
+        } else {
+            Weight farthest{};
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                if (covered[components[vertex]] && separation[vertex] > farthest) {
+                    farthest = separation[vertex];
+                    landmark = vertex;
+                }
+            }
+        }
+        if (!landmark) {
+            break;
+        }
+
+        ShortestPathTree<Weight> from_tree(graph, *landmark, edge_weight);
+        ShortestPathTree<Weight> to_tree(reversed, *landmark, edge_weight);
+        std::vector<Weight> from_column(vertex_count, INFINITE_WEIGHT);
+        std::vector<Weight> to_column(vertex_count, INFINITE_WEIGHT);
+        for (VertexId vertex : from_tree.GetReached()) {
+            from_column[vertex] = from_tree.GetWeight(vertex);
+        }
+        for (VertexId vertex : to_tree.GetReached()) {
+            to_column[vertex] = to_tree.GetWeight(vertex);
+        }
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (components[vertex] != components[*landmark]) {
+                continue;
+            }
+            const bool from_reached = from_column[vertex] != INFINITE_WEIGHT;
+            const bool to_reached = to_column[vertex] != INFINITE_WEIGHT;
+            if (from_reached || to_reached) {
+                const Weight sum = (from_reached ? from_column[vertex] : Weight{}) + (to_reached ? to_column[vertex] : Weight{});
+                separation[vertex] = std::min(separation[vertex], sum);
+            }
+        }
+        separation[*landmark] = Weight{};
+        vertices_.push_back(*landmark);
+        from_columns.push_back(std::move(from_column));
+        to_columns.push_back(std::move(to_column));
+    }
+
+    const size_t count = vertices_.size();
+    from_landmarks_.resize(vertex_count * count);
+    to_landmarks_.resize(vertex_count * count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        for (size_t i = 0; i < count; ++i) {
+            from_landmarks_[vertex * count + i] = from_columns[i][vertex];
+            to_landmarks_[vertex * count + i] = to_columns[i][vertex];
+        }
+    }
+}
+
+template <typename Weight>
+Landmarks<Weight>::Landmarks(std::vector<VertexId> vertices, std::vector<Weight> from_landmarks, std::vector<Weight> to_landmarks)
+    : vertices_(std::move(vertices))
+    , from_landmarks_(std::move(from_landmarks))
+    , to_landmarks_(std::move(to_landmarks)) {
+    if (from_landmarks_.size() != to_landmarks_.size()
+        || (vertices_.empty() ? !from_landmarks_.empty() : from_landmarks_.size() % vertices_.size() != 0)) {
+        throw std::invalid_argument("Landmark distances don't match landmarks");
+    }
+}
+
+template <typename Weight>
+bool Landmarks<Weight>::IsEmpty() const {
+    return vertices_.empty();
+}
+
+template <typename Weight>
+const std::vector<VertexId>& Landmarks<Weight>::GetVertices() const {
+    return vertices_;
+}
+
+template <typename Weight>
+const std::vector<Weight>& Landmarks<Weight>::GetFromLandmarks() const {
+    return from_landmarks_;
+}
+
+template <typename Weight>
+const std::vector<Weight>& Landmarks<Weight>::GetToLandmarks() const {
+    return to_landmarks_;
+}
+
+template <typename Weight>
+Weight Landmarks<Weight>::GetLowerBound(VertexId from, VertexId to) const {
+    const size_t count = vertices_.size();
+    const Weight* landmark_to_from = from_landmarks_.data() + from * count;
+    const Weight* landmark_to_to = from_landmarks_.data() + to * count;
+    const Weight* from_to_landmark = to_landmarks_.data() + from * count;
+    const Weight* to_to_landmark = to_landmarks_.data() + to * count;
+    Weight bound{};
+    for (size_t i = 0; i < count; ++i) {
+        // d(L, to) <= d(L, from) + d(from, to)
+        if (landmark_to_to[i] != INFINITE_WEIGHT) {
+            if (landmark_to_from[i] != INFINITE_WEIGHT) {
+                bound = std::max(bound, landmark_to_to[i] - landmark_to_from[i]);
+            }
+        } else if (landmark_to_from[i] != INFINITE_WEIGHT) {
+            return INFINITE_WEIGHT; // L reaches `from` but not `to`
+        }
+        // d(from, L) <= d(from, to) + d(to, L)
+        if (from_to_landmark[i] != INFINITE_WEIGHT) {
+            if (to_to_landmark[i] != INFINITE_WEIGHT) {
+                bound = std::max(bound, from_to_landmark[i] - to_to_landmark[i]);
+            }
+        } else if (to_to_landmark[i] != INFINITE_WEIGHT) {
+            return INFINITE_WEIGHT; // `to` reaches L but `from` doesn't
+        }
+    }
+    return bound;
+}
+
+template <typename Weight>
+LandmarkPath<Weight>::LandmarkPath(const Graph& graph, const Landmarks<Weight>& landmarks, VertexId from, VertexId to)
+    : graph_(graph)
+    , to_(to)
+    , weights_(graph.GetVertexCount(), Landmarks<Weight>::INFINITE_WEIGHT)
+    , prev_edges_(graph.GetVertexCount())
+    , settled_(graph.GetVertexCount(), false) {
+    // slightly shrunk bounds stay consistent and can't exceed the true distance
+    // because of rounding in the sums of the landmark distances
+    constexpr Weight BOUND_SCALE = 1 - 1e-9;
+    std::vector<std::optional<Weight>> bounds(graph.GetVertexCount());
+    auto get_bound = [&](VertexId vertex) {
+        if (!bounds[vertex]) {
+            bounds[vertex] = landmarks.GetLowerBound(vertex, to) * BOUND_SCALE;
+        }
+        return *bounds[vertex];
+    };
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+    if (get_bound(from) == Landmarks<Weight>::INFINITE_WEIGHT) {
+        return;
+    }
+    weights_.at(from) = Weight{};
+    queue.push({get_bound(from), from});
+    while (!queue.empty()) {
+        const VertexId vertex = queue.top().second;
+        queue.pop();
+        if (settled_[vertex]) {
+            continue;
+        }
+        settled_[vertex] = true;
+        ++settled_count_;
+        if (vertex == to) {
+            break;
+        }
+        const Weight weight = weights_[vertex];
+        for (EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            const auto& edge = graph.GetEdge(edge_id);
+            if (edge.weight < Weight{}) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            const Weight candidate = weight + edge.weight;
+            if (!settled_[edge.to] && candidate < weights_[edge.to]) {
+                const Weight bound = get_bound(edge.to);
+                if (bound == Landmarks<Weight>::INFINITE_WEIGHT) {
+                    continue;
+                }
+                weights_[edge.to] = candidate;
+                prev_edges_[edge.to] = edge_id;
+                queue.push({candidate + bound, edge.to});
+            }
+        }
+    }
+}
+
+template <typename Weight>
+bool LandmarkPath<Weight>::IsFound() const {
+    return settled_.at(to_);
+}
+
+template <typename Weight>
+Weight LandmarkPath<Weight>::GetWeight() const {
+    return weights_.at(to_);
+}
+
+template <typename Weight>
+std::vector<EdgeId> LandmarkPath<Weight>::GetEdges() const {
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = prev_edges_.at(to_); edge_id; edge_id = prev_edges_[graph_.GetEdge(*edge_id).from]) {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    return edges;
+}
+
+template <typename Weight>
+size_t LandmarkPath<Weight>::GetSettledCount() const {
+    return settled_count_;
+}
+
+}  // namespace graph
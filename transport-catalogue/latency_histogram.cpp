@@ -0,0 +1,90 @@
+#include "latency_histogram.h"
+#include "json_builder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace transport {
+namespace profile {
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < 2 * SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value);
+    }
+    int msb = 63;
+    while ((value >> msb) == 0) {
+        --msb;
+    }
+    const int shift = msb - SUB_BUCKET_BITS;
+    return static_cast<size_t>(shift) * SUB_BUCKET_COUNT + static_cast<size_t>(value >> shift);
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t index) {
+    if (index < 2 * SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const uint64_t shift = index / SUB_BUCKET_COUNT - 1;
+    const uint64_t top = index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+    return (top << shift) + ((uint64_t{1} << shift) - 1);
+}
+
+void LatencyHistogram::Record(uint64_t value_ns) {
+    ++counts_[GetBucketIndex(value_ns)];
+    ++total_count_;
+    max_ = std::max(max_, value_ns);
+    sum_ += value_ns;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    total_count_ += other.total_count_;
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return total_count_;
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+    return max_;
+}
+
+double LatencyHistogram::GetMean() const {
+    return total_count_ == 0 ? 0.0 : static_cast<double>(sum_ / total_count_);
+}
+
+uint64_t LatencyHistogram::GetQuantile(double q) const {
+    if (total_count_ == 0) {
+        return 0;
+    }
+    q = std::clamp(q, 0.0, 1.0);
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * total_count_)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            return std::min(GetBucketUpperBound(i), max_);
+        }
+    }
+    return max_;
+}
+
+json::Node LatencyHistogram::BuildReport() const {
+    auto to_ms = [](double ns) {
+        return ns / 1e6;
+    };
+    return json::Builder{}.StartDict()
+        .Key("count").Value(static_cast<double>(total_count_))
+        .Key("mean_ms").Value(to_ms(GetMean()))
+        .Key("p50_ms").Value(to_ms(static_cast<double>(GetQuantile(0.5))))
+        .Key("p90_ms").Value(to_ms(static_cast<double>(GetQuantile(0.9))))
+        .Key("p99_ms").Value(to_ms(static_cast<double>(GetQuantile(0.99))))
+        .Key("max_ms").Value(to_ms(static_cast<double>(max_)))
+        .EndDict().Build();
+}
+
+} // end namespace profile
+} // end namespace transport
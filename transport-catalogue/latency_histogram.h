@@ -0,0 +1,49 @@
+#pragma once
+
+#include "json.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace transport {
+namespace profile {
+
+// Log-linear histogram of durations in nanoseconds in the spirit of HdrHistogram:
+// values below 128 ns are exact, larger ones fall into 64 sub-buckets per power
+// of two, so any reported percentile is within 1.6% of the recorded value.
+class LatencyHistogram {
+public:
+    void Record(uint64_t value_ns);
+    void Merge(const LatencyHistogram& other);
+
+    uint64_t GetCount() const;
+    uint64_t GetMax() const;
+    double GetMean() const;
+    // Upper bound of the bucket holding the given quantile, q in [0, 1]
+    uint64_t GetQuantile(double q) const;
+
+    // count, mean, p50, p90, p99 and max in milliseconds
+    json::Node BuildReport() const;
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 6;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS) * SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+
+    static size_t GetBucketIndex(uint64_t value);
+    static uint64_t GetBucketUpperBound(size_t index);
+
+    std::array<uint64_t, BUCKET_COUNT> counts_{};
+    uint64_t total_count_ = 0;
+    uint64_t max_ = 0;
+    long double sum_ = 0;
+};
+
+// Histograms by request type
+using LatencyHistograms = std::map<std::string, LatencyHistogram, std::less<>>;
+
+} // end namespace profile
+} // end namespace transport
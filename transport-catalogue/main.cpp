@@ -1,51 +1,170 @@
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <memory_resource>
+#include <optional>
 #include <string_view>
 
+#include "catalogue_snapshot.h"
 #include "json_reader.h"
+#include "profiler.h"
 #include "serialization.h"
 
 using namespace std::literals;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|process_requests|serve] [--profile]\n"sv;
+}
+
+// Answers a stream of process_requests documents. When a document names another
+// serialization file, the file is loaded in the background and swapped in; the
+// document waits for it, as its answers have to come from that file. Requests of
+// a document without a loaded file are answered with an error message.
+// Returns profiling_settings of the last document that had them.
+std::optional<json::Dict> Serve(std::istream& input, std::ostream& output) {
+    transport::profile::Profiler& profiler = transport::profile::GetProfiler();
+    transport::SnapshotHolder holder;
+    // LatencyStats and the report at exit cover all documents answered so far
+    transport::profile::LatencyHistograms latencies;
+    std::optional<json::Dict> profiling_settings;
+    while (input >> std::ws && input.peek() != std::char_traits<char>::eof()) {
+        // the document and the readers answering it are dropped at the end of the iteration
+        std::pmr::monotonic_buffer_resource document_arena;
+        auto parse_start = transport::profile::Clock::now();
+        json::Document document = json::Load(input, &document_arena);
+        auto snapshot = holder.Get();
+        std::string file;
+        {
+            transport::io::JsonReader settings_reader(*snapshot);
+            settings_reader.SetRequests(document);
+            file = settings_reader.ProcessSerializationSettings().at("file").AsString();
+            if (auto settings = settings_reader.ProcessProfilingSettings()) {
+                profiler.Enable();
+                if (!settings->at("trace_file").AsString().empty()) {
+                    profiler.EnableTrace();
+                }
+                profiling_settings = std::move(settings);
+            }
+        }
+        profiler.RecordPhase("json_parse", "phase", parse_start, transport::profile::Clock::now());
+        if (!file.empty() && file != snapshot->GetFile()) {
+            transport::profile::ScopedPhase phase("load_data");
+            // readers of the current snapshot on other threads go on meanwhile
+            if (holder.ReloadAsync(file).get()) {
+                snapshot = holder.Get();
+            }
+        }
+        transport::io::JsonReader reader(*snapshot);
+        reader.SetRequests(std::move(document));
+        if (snapshot->GetFile().empty() || (!file.empty() && file != snapshot->GetFile())) {
+            const std::string_view message = file.empty() ? "no base loaded"sv : "base not loaded"sv;
+            std::cerr << "Couldn't answer the document: " << message << (file.empty() ? "" : " from " + file) << std::endl;
+            reader.RejectStatRequests(output, message);
+        } else {
+            reader.SetLatencyHistograms(latencies);
+            reader.ProcessStatRequests(output);
+        }
+        output << std::endl;
+    }
+    return profiling_settings;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    if (argc != 2 && argc != 3) {
         PrintUsage();
         return 1;
     }
+    if (argc == 3) {
+        if (std::string_view(argv[2]) != "--profile"sv) {
+            PrintUsage();
+            return 1;
+        }
+        transport::profile::GetProfiler().Enable();
+    }
+    transport::profile::Profiler& profiler = transport::profile::GetProfiler();
+
+    const std::string_view mode(argv[1]);
+
+    if (mode == "serve"sv) {
+        if (auto profiling_settings = Serve(std::cin, std::cout)) {
+            profiler.WriteReports(profiling_settings->at("report_file").AsString(),
+                                  profiling_settings->at("trace_file").AsString());
+        } else {
+            profiler.WriteReports("", "");
+        }
+        return 0;
+    }
 
-    transport::TransportCatalogue catalogue;
+    // Arenas of the two long-lived phase results, released in bulk at exit:
+    // the parsed input and the catalogue. Both are filled by this thread only.
+    std::pmr::monotonic_buffer_resource document_arena;
+    std::pmr::monotonic_buffer_resource catalogue_arena;
+    transport::TransportCatalogue catalogue(&catalogue_arena);
     transport::renderer::MapRenderer renderer;
     transport::TransportRouter router(catalogue);
     transport::RequestHandler handler(catalogue, renderer);
     transport::io::JsonReader reader(catalogue, handler, renderer, router);
 
-    const std::string_view mode(argv[1]);
+    if (mode != "make_base"sv && mode != "process_requests"sv) {
+        PrintUsage();
+        return 1;
+    }
+
+    // profiling_settings is only known after parsing, so the parse is timed by hand
+    auto parse_start = transport::profile::Clock::now();
+    reader.ReadJsonFromStream(std::cin, &document_arena);
+    auto profiling_settings = reader.ProcessProfilingSettings();
+    if (profiling_settings) {
+        profiler.Enable();
+        if (!profiling_settings->at("trace_file").AsString().empty()) {
+            profiler.EnableTrace();
+        }
+    }
+    profiler.RecordPhase("json_parse", "phase", parse_start, transport::profile::Clock::now());
 
     if (mode == "make_base"sv) {
 
         // make base here
-        reader.ReadJsonFromStream(std::cin);
-        reader.FillDB();
+        std::shared_ptr<const transport::FrozenCatalogue> previous;
+        if (auto previous_file = reader.GetPreviousBaseFile()) {
+            transport::profile::ScopedPhase phase("load_previous");
+            previous = transport::FrozenCatalogue::Load(*previous_file);
+            if (previous == nullptr) {
+                return 1;
+            }
+        }
+        {
+            transport::profile::ScopedPhase phase("fill_db");
+            if (previous != nullptr) {
+                reader.ApplyBaseUpdate(*previous);
+            } else {
+                reader.FillDB();
+            }
+        }
         transport::Serializer serializer(catalogue, renderer, router, reader);
         reader.ProcessAndApplyRenderSettings();
         reader.ProcessAndApplyRouterSettings();
-        router.Init();
+        if (previous != nullptr) {
+            router.SetPrevious(&previous->GetRouter());
+        }
         serializer.SaveData();
 
-    } else if (mode == "process_requests"sv) {
+    } else {
 
         // process requests here
-        reader.ReadJsonFromStream(std::cin);
         transport::Serializer serializer(catalogue, renderer, router, reader);
-        serializer.LoadData();
+        {
+            transport::profile::ScopedPhase phase("load_data");
+            serializer.LoadData();
+        }
         reader.ProcessStatRequests(std::cout);
 
+    }
+
+    if (profiling_settings) {
+        profiler.WriteReports(profiling_settings->at("report_file").AsString(),
+                              profiling_settings->at("trace_file").AsString());
     } else {
-        PrintUsage();
-        return 1;
+        profiler.WriteReports("", "");
     }
 }
@@ -24,18 +24,11 @@ const RenderSettings& MapRenderer::GetSettings() const {
     return render_settings_;
 }
     
-svg::Document MapRenderer::RenderMap(const std::vector<const Bus*>& buses) const {
+svg::Document MapRenderer::RenderMap(const std::vector<const Bus*>& buses, std::pmr::memory_resource* resource) const {
     std::unordered_set<const Stop*, StopHasher> stops;
     for(const auto& bus: buses) {
-        if (bus->is_roundtrip == false) {
-            for (int i=0; i<static_cast<int>(bus->stops.size() - 1 / 2); ++i) {
-                stops.insert(bus->stops[i]);
-            }
-        } else {
-            for(const auto& stop: bus->stops) {
-                stops.insert(stop);
-            }
-        }
+        // the way back of a non-roundtrip bus passes the same stops
+        stops.insert(bus->stops.begin(), bus->stops.end());
     }
     std::vector<const Stop*> sorted_stops(stops.begin(), stops.end());
     std::sort(sorted_stops.begin(), sorted_stops.end(),
@@ -49,7 +42,7 @@ svg::Document MapRenderer::RenderMap(const std::vector<const Bus*>& buses) const
     
     SphereProjector projector(points.begin(), points.end(), render_settings_.width, render_settings_.height, render_settings_.padding);
 
-    svg::Document doc;
+    svg::Document doc(resource);
     RenderBuses(buses, doc, projector);
     RenderBusNames(buses, doc, projector);
     RenderStops(sorted_stops, doc, projector);
@@ -68,7 +61,7 @@ void MapRenderer::RenderBuses(const std::vector<const Bus*>& buses, svg::Documen
             .SetStrokeWidth(render_settings_.line_width)
             .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
             .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-        for(const auto& stop: bus->stops) {
+        for(const Stop* stop: bus->GetRoute()) {
             line.AddPoint(projector(stop->coordinates));
         }
         doc.Add(line);
@@ -86,7 +79,7 @@ void MapRenderer::RenderBusNames(const std::vector<const Bus*>& buses, svg::Docu
             .SetFontSize(render_settings_.bus_label_font_size)
             .SetFontFamily("Verdana")
             .SetFontWeight("bold")
-            .SetData(bus->name);
+            .SetData(std::string(bus->name));
         svg::Text underlayer{text};
         underlayer.SetFillColor(render_settings_.underlayer_color)
                   .SetStrokeColor(render_settings_.underlayer_color)
@@ -96,10 +89,10 @@ void MapRenderer::RenderBusNames(const std::vector<const Bus*>& buses, svg::Docu
         text.SetFillColor(render_settings_.color_palette[color_index % palette_size]);
         doc.Add(underlayer);
         doc.Add(text);
-        if (bus->is_roundtrip == false && bus->stops[(bus->stops.size() - 1) / 2] != bus->stops[0]) {
+        if (bus->is_roundtrip == false && bus->stops.back() != bus->stops[0]) {
             svg::Text text2{text};
             svg::Text underlayer2{underlayer};
-            svg::Point pos{projector(bus->stops[(bus->stops.size() - 1) / 2]->coordinates)};
+            svg::Point pos{projector(bus->stops.back()->coordinates)};
             text2.SetPosition(pos);
             underlayer2.SetPosition(pos);
             doc.Add(underlayer2);
@@ -126,7 +119,7 @@ void MapRenderer::RenderStopNames(const std::vector<const Stop*>& stops, svg::Do
             .SetOffset(render_settings_.stop_label_offset)
             .SetFontSize(render_settings_.stop_label_font_size)
             .SetFontFamily("Verdana")
-            .SetData(stop->name);
+            .SetData(std::string(stop->name));
         svg::Text underlayer{text};
         underlayer.SetFillColor(render_settings_.underlayer_color)
                   .SetStrokeColor(render_settings_.underlayer_color)
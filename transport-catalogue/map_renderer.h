@@ -53,7 +53,9 @@ public:
     MapRenderer() = default;
     void ApplySettings(const RenderSettings& settings);
     const RenderSettings& GetSettings() const;
-    svg::Document RenderMap(const std::vector<const Bus*>& buses) const;
+    // Objects of the document are allocated from the resource
+    svg::Document RenderMap(const std::vector<const Bus*>& buses,
+                            std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
 private:
     void RenderBuses(const std::vector<const Bus*>& buses, svg::Document& doc, const SphereProjector& projector) const;
     void RenderBusNames(const std::vector<const Bus*>& buses, svg::Document& doc, const SphereProjector& projector) const;
@@ -0,0 +1,68 @@
+#include "name_pool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace transport {
+
+std::string_view NamePool::Intern(std::string_view name) {
+    if (auto it = offsets_.find(name); it != offsets_.end()) {
+        return it->first;
+    }
+    if (blocks_.empty() || blocks_.back().capacity() - blocks_.back().size() < name.size()) {
+        block_offsets_.push_back(GetSize());
+        blocks_.emplace_back().reserve(std::max(BLOCK_SIZE, name.size()));
+    }
+    std::string& block = blocks_.back();
+    const size_t offset = block.size();
+    block.append(name); // fits into capacity, so no reallocation
+    std::string_view result = GetBlockPart(blocks_.size() - 1, offset, name.size());
+    offsets_[result] = static_cast<uint32_t>(block_offsets_.back() + offset);
+    return result;
+}
+
+NameRef NamePool::GetRef(std::string_view name) const {
+    return {offsets_.at(name), static_cast<uint32_t>(name.size())};
+}
+
+std::string_view NamePool::Get(NameRef ref) {
+    auto it = std::upper_bound(block_offsets_.begin(), block_offsets_.end(), size_t{ref.offset});
+    if (it == block_offsets_.begin()) {
+        throw std::out_of_range("Name is out of the pool");
+    }
+    const size_t block = static_cast<size_t>(it - block_offsets_.begin()) - 1;
+    const size_t offset = ref.offset - block_offsets_[block];
+    if (offset + ref.length > blocks_[block].size()) {
+        throw std::out_of_range("Name is out of the pool");
+    }
+    std::string_view result = GetBlockPart(block, offset, ref.length);
+    offsets_.emplace(result, ref.offset);
+    return result;
+}
+
+std::string NamePool::Save() const {
+    std::string result;
+    result.reserve(GetSize());
+    for (const std::string& block : blocks_) {
+        result += block;
+    }
+    return result;
+}
+
+void NamePool::Load(std::string data) {
+    blocks_.clear();
+    block_offsets_.clear();
+    offsets_.clear();
+    block_offsets_.push_back(0);
+    blocks_.push_back(std::move(data));
+}
+
+size_t NamePool::GetSize() const {
+    return blocks_.empty() ? 0 : block_offsets_.back() + blocks_.back().size();
+}
+
+std::string_view NamePool::GetBlockPart(size_t block, size_t offset, size_t length) const {
+    return std::string_view(blocks_[block].data() + offset, length);
+}
+
+} // end namespace transport
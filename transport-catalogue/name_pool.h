@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace transport {
+
+// Position of a name in the concatenation of all pool blocks
+struct NameRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+// Interned Stop and Bus names. Bytes live in a few large blocks that are never
+// reallocated, so views handed out stay valid for the lifetime of the pool.
+// Saved as one blob and loaded back as a single block without per-name copies.
+class NamePool {
+public:
+    // Returns a view into the pool, equal names share the bytes
+    std::string_view Intern(std::string_view name);
+    // name must be interned, throws std::out_of_range otherwise
+    NameRef GetRef(std::string_view name) const;
+    // Resolves a reference into loaded data, throws std::out_of_range if it doesn't fit
+    std::string_view Get(NameRef ref);
+
+    std::string Save() const;
+    void Load(std::string data);
+    size_t GetSize() const;
+
+private:
+    static constexpr size_t BLOCK_SIZE = size_t{1} << 16;
+
+    std::string_view GetBlockPart(size_t block, size_t offset, size_t length) const;
+
+    std::deque<std::string> blocks_;
+    std::vector<size_t> block_offsets_;
+    std::unordered_map<std::string_view, uint32_t> offsets_;
+};
+
+} // end namespace transport
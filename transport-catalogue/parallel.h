@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace transport {
+namespace parallel {
+
+inline size_t GetThreadCount(size_t task_count, size_t min_chunk = 64) {
+    size_t hardware = std::max<size_t>(1, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min(hardware, task_count / std::max<size_t>(1, min_chunk)));
+}
+
+// Splits [0, count) into contiguous chunks and calls func(begin, end, chunk_index)
+// for each of them on its own thread. Chunk boundaries depend only on count and
+// the thread count, so callers may merge per-chunk results deterministically.
+// The first exception thrown by any chunk is rethrown after all threads join.
+template <typename Func>
+void ForEachChunk(size_t count, size_t thread_count, Func func) {
+    if (count == 0) {
+        return;
+    }
+    thread_count = std::max<size_t>(1, std::min(thread_count, count));
+    if (thread_count == 1) {
+        func(size_t{0}, count, size_t{0});
+        return;
+    }
+    const size_t chunk = (count + thread_count - 1) / thread_count;
+    std::vector<std::exception_ptr> errors(thread_count);
+    auto run = [&func, &errors](size_t begin, size_t end, size_t t) {
+        try {
+            func(begin, end, t);
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t t = 1; t < thread_count; ++t) {
+        size_t begin = std::min(count, t * chunk);
+        size_t end = std::min(count, begin + chunk);
+        threads.emplace_back(run, begin, end, t);
+    }
+    run(size_t{0}, std::min(count, chunk), size_t{0});
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+} // end namespace parallel
+} // end namespace transport
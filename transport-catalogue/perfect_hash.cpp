@@ -0,0 +1,150 @@
+#include "perfect_hash.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace transport {
+
+namespace {
+
+constexpr size_t KEYS_PER_BUCKET = 4;
+
+uint64_t Mix(uint64_t x) {
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t HashName(std::string_view name, uint64_t salt) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL ^ Mix(salt);
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return Mix(hash);
+}
+
+size_t GetBucket(uint64_t hash, size_t bucket_count) {
+    return static_cast<size_t>((hash >> 32) % bucket_count);
+}
+
+} // namespace
+
+PerfectHashIndex::PerfectHashIndex(uint64_t salt, std::vector<uint32_t> seeds, std::vector<uint32_t> ids)
+    : salt_(salt)
+    , seeds_(std::move(seeds))
+    , ids_(std::move(ids)) {
+    if (seeds_.empty() || ids_.empty()) {
+        Clear();
+    }
+}
+
+void PerfectHashIndex::Build(const std::vector<std::pair<std::string_view, uint32_t>>& names) {
+    Clear();
+    if (names.empty()) {
+        return;
+    }
+    for (uint64_t salt = 0; !TryBuild(names, salt); ++salt) {
+    }
+}
+
+void PerfectHashIndex::Clear() {
+    salt_ = 0;
+    seeds_.clear();
+    ids_.clear();
+}
+
+size_t PerfectHashIndex::Find(std::string_view name) const {
+    if (IsEmpty()) {
+        return NPOS;
+    }
+    const uint64_t hash = HashName(name, salt_);
+    return ids_[GetSlot(hash, seeds_[GetBucket(hash, seeds_.size())])];
+}
+
+bool PerfectHashIndex::IsEmpty() const {
+    return ids_.empty();
+}
+
+size_t PerfectHashIndex::GetSize() const {
+    return ids_.size();
+}
+
+uint64_t PerfectHashIndex::GetSalt() const {
+    return salt_;
+}
+
+const std::vector<uint32_t>& PerfectHashIndex::GetSeeds() const {
+    return seeds_;
+}
+
+const std::vector<uint32_t>& PerfectHashIndex::GetIds() const {
+    return ids_;
+}
+
+bool PerfectHashIndex::TryBuild(const std::vector<std::pair<std::string_view, uint32_t>>& names, uint64_t salt) {
+    const size_t n = names.size();
+    const size_t bucket_count = n / KEYS_PER_BUCKET + 1;
+    salt_ = salt;
+    seeds_.assign(bucket_count, 0);
+    ids_.assign(n, 0);
+
+    std::vector<uint64_t> hashes(n);
+    std::vector<std::vector<size_t>> buckets(bucket_count);
+    for (size_t i = 0; i < n; ++i) {
+        hashes[i] = HashName(names[i].first, salt);
+        buckets[GetBucket(hashes[i], bucket_count)].push_back(i);
+    }
+    std::vector<size_t> order(bucket_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&buckets](size_t lhs, size_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    // a single key needs n / free_slots tries on average, the bound makes a failure
+    // practically impossible; a failed attempt starts over with another salt
+    const uint64_t max_seed = 16 * static_cast<uint64_t>(n) + 1024;
+    std::vector<bool> taken(n, false);
+    std::vector<size_t> slots;
+    for (size_t bucket : order) {
+        const auto& keys = buckets[bucket];
+        if (keys.empty()) {
+            break;
+        }
+        bool placed = false;
+        for (uint64_t seed = 0; seed < max_seed && !placed; ++seed) {
+            slots.clear();
+            placed = true;
+            for (size_t key : keys) {
+                size_t slot = GetSlot(hashes[key], static_cast<uint32_t>(seed));
+                if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                    placed = false;
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (placed) {
+                seeds_[bucket] = static_cast<uint32_t>(seed);
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    taken[slots[i]] = true;
+                    ids_[slots[i]] = names[keys[i]].second;
+                }
+            }
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t PerfectHashIndex::GetSlot(uint64_t hash, uint32_t seed) const {
+    return static_cast<size_t>(Mix(hash ^ (seed * 0x9e3779b97f4a7c15ULL)) % ids_.size());
+}
+
+} // end namespace transport
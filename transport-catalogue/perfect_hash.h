@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace transport {
+
+// Minimal perfect hash over a fixed set of names (hash and displace): keys are
+// spread over buckets and every bucket gets a seed that sends its keys to free
+// slots, so each of n keys owns one of n slots. Lookup is one hash of the name
+// and one probe; the caller compares the name at the returned id to confirm.
+// Hashes are platform independent, so a built index can be saved and loaded.
+class PerfectHashIndex {
+public:
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+
+    PerfectHashIndex() = default;
+    PerfectHashIndex(uint64_t salt, std::vector<uint32_t> seeds, std::vector<uint32_t> ids);
+
+    // Names must be distinct
+    void Build(const std::vector<std::pair<std::string_view, uint32_t>>& names);
+    void Clear();
+
+    // Id stored for the slot of name, NPOS if the index is empty
+    size_t Find(std::string_view name) const;
+
+    bool IsEmpty() const;
+    size_t GetSize() const;
+    uint64_t GetSalt() const;
+    const std::vector<uint32_t>& GetSeeds() const;
+    const std::vector<uint32_t>& GetIds() const;
+
+private:
+    bool TryBuild(const std::vector<std::pair<std::string_view, uint32_t>>& names, uint64_t salt);
+    size_t GetSlot(uint64_t hash, uint32_t seed) const;
+
+    uint64_t salt_ = 0;
+    std::vector<uint32_t> seeds_; // per bucket
+    std::vector<uint32_t> ids_;   // per slot
+};
+
+} // end namespace transport
@@ -0,0 +1,229 @@
+#include "profiler.h"
+#include "json_builder.h"
+
+#include <algorithm>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace transport {
+namespace profile {
+
+int64_t GetPeakRssKb() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<int64_t>(counters.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#elif defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return static_cast<int64_t>(usage.ru_maxrss / 1024); // bytes on macOS
+#else
+    return static_cast<int64_t>(usage.ru_maxrss);
+#endif
+#else
+    return 0;
+#endif
+}
+
+Profiler::Profiler()
+    : origin_(Clock::now()) {
+}
+
+void Profiler::Enable() {
+    enabled_ = true;
+}
+
+bool Profiler::IsEnabled() const {
+    return enabled_;
+}
+
+void Profiler::EnableTrace() {
+    trace_enabled_ = true;
+}
+
+void Profiler::Reset() {
+    std::lock_guard lock(mutex_);
+    aggregates_.clear();
+    records_.clear();
+    counters_.clear();
+    sections_.clear();
+}
+
+Clock::time_point Profiler::GetOrigin() const {
+    return origin_;
+}
+
+size_t Profiler::GetThreadIndex(std::thread::id id) {
+    auto [it, inserted] = thread_indexes_.emplace(id, thread_indexes_.size());
+    return it->second;
+}
+
+void Profiler::RecordPhase(std::string_view name, std::string_view category, Clock::time_point start, Clock::time_point finish,
+                           bool sample_rss) {
+    if (!enabled_) {
+        return;
+    }
+    std::chrono::duration<double, std::micro> start_us = start - origin_;
+    std::chrono::duration<double, std::micro> duration_us = finish - start;
+    int64_t peak_rss = sample_rss ? GetPeakRssKb() : -1;
+    std::lock_guard lock(mutex_);
+    auto it = aggregates_.find(name);
+    if (it == aggregates_.end()) {
+        it = aggregates_.emplace(std::string(name), PhaseAggregate{std::string(category), aggregates_.size()}).first;
+    }
+    PhaseAggregate& a = it->second;
+    ++a.calls;
+    a.total_us += duration_us.count();
+    a.max_us = std::max(a.max_us, duration_us.count());
+    a.process_peak_rss_kb = std::max(a.process_peak_rss_kb, peak_rss);
+    if (trace_enabled_) {
+        records_.push_back({std::string(name), std::string(category), start_us.count(), duration_us.count(),
+                            peak_rss, GetThreadIndex(std::this_thread::get_id())});
+    }
+}
+
+void Profiler::AddCounter(std::string_view name, int64_t value) {
+    if (!enabled_) {
+        return;
+    }
+    std::lock_guard lock(mutex_);
+    auto it = counters_.find(name);
+    if (it == counters_.end()) {
+        counters_.emplace(std::string(name), value);
+    } else {
+        it->second += value;
+    }
+}
+
+void Profiler::SetReportSection(std::string_view name, json::Node section) {
+    if (!enabled_) {
+        return;
+    }
+    std::lock_guard lock(mutex_);
+    sections_[std::string(name)] = std::move(section);
+}
+
+json::Node Profiler::BuildReport() const {
+    std::lock_guard lock(mutex_);
+    // phases are listed in the order they first ran
+    std::vector<std::pair<const std::string*, const PhaseAggregate*>> ordered;
+    for (const auto& [name, aggregate] : aggregates_) {
+        ordered.push_back({&name, &aggregate});
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second->order < rhs.second->order;
+    });
+
+    json::Array phases;
+    for (const auto& [name, a] : ordered) {
+        json::Dict phase = json::Builder{}.StartDict()
+            .Key("name").Value(*name)
+            .Key("category").Value(a->category)
+            .Key("calls").Value(a->calls)
+            .Key("total_ms").Value(a->total_us / 1000.0)
+            .Key("max_ms").Value(a->max_us / 1000.0)
+            .EndDict().Build().AsDict();
+        if (a->process_peak_rss_kb >= 0) {
+            // cumulative: the peak of the whole process up to the end of the phase
+            phase["process_peak_rss_kb"] = json::Node{static_cast<double>(a->process_peak_rss_kb)};
+        }
+        phases.emplace_back(std::move(phase));
+    }
+    json::Dict counters;
+    for (const auto& [name, value] : counters_) {
+        counters[name] = json::Node{static_cast<double>(value)};
+    }
+    json::Dict report = json::Builder{}.StartDict()
+        .Key("phases").Value(phases)
+        .Key("counters").Value(counters)
+        .Key("peak_rss_kb").Value(static_cast<double>(GetPeakRssKb()))
+        .EndDict().Build().AsDict();
+    for (const auto& [name, section] : sections_) {
+        report[name] = section;
+    }
+    return report;
+}
+
+json::Node Profiler::BuildChromeTrace() const {
+    std::lock_guard lock(mutex_);
+    json::Array events;
+    for (const PhaseRecord& r : records_) {
+        json::Dict args;
+        if (r.process_peak_rss_kb >= 0) {
+            args["process_peak_rss_kb"] = json::Node{static_cast<double>(r.process_peak_rss_kb)};
+        }
+        events.emplace_back(json::Builder{}.StartDict()
+            .Key("name").Value(r.name)
+            .Key("cat").Value(r.category)
+            .Key("ph").Value("X")
+            .Key("ts").Value(r.start_us)
+            .Key("dur").Value(r.duration_us)
+            .Key("pid").Value(1)
+            .Key("tid").Value(static_cast<int>(r.thread_index))
+            .Key("args").Value(std::move(args))
+            .EndDict().Build());
+    }
+    return json::Builder{}.StartDict()
+        .Key("traceEvents").Value(events)
+        .Key("displayTimeUnit").Value("ms")
+        .EndDict().Build();
+}
+
+void Profiler::WriteReports(std::string_view report_file, std::string_view trace_file) const {
+    if (!enabled_) {
+        return;
+    }
+    if (report_file.empty()) {
+        json::Print(json::Document{BuildReport()}, std::cerr);
+        std::cerr << std::endl;
+    } else {
+        std::ofstream out{std::string(report_file)};
+        if (!out) {
+            std::cerr << "Couldn't open profile report file " << report_file << std::endl;
+        } else {
+            json::Print(json::Document{BuildReport()}, out);
+        }
+    }
+    if (!trace_file.empty()) {
+        std::ofstream out{std::string(trace_file)};
+        if (!out) {
+            std::cerr << "Couldn't open trace file " << trace_file << std::endl;
+        } else {
+            json::Print(json::Document{BuildChromeTrace()}, out);
+        }
+    }
+}
+
+Profiler& GetProfiler() {
+    static Profiler profiler;
+    return profiler;
+}
+
+ScopedPhase::ScopedPhase(std::string_view name, std::string_view category)
+    : enabled_(GetProfiler().IsEnabled()) {
+    if (enabled_) {
+        name_ = name;
+        category_ = category;
+        start_ = Clock::now();
+    }
+}
+
+ScopedPhase::~ScopedPhase() {
+    if (enabled_) {
+        GetProfiler().RecordPhase(name_, category_, start_, Clock::now());
+    }
+}
+
+} // end namespace profile
+} // end namespace transport
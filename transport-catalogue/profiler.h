@@ -0,0 +1,96 @@
+#pragma once
+
+#include "json.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace transport {
+namespace profile {
+
+using Clock = std::chrono::steady_clock;
+
+// Peak resident set size of the process in kilobytes, 0 if unavailable
+int64_t GetPeakRssKb();
+
+// -1 when the phase didn't sample memory
+struct PhaseRecord {
+    std::string name;
+    std::string category;
+    double start_us;
+    double duration_us;
+    int64_t process_peak_rss_kb;
+    size_t thread_index;
+};
+
+// Collects timings of named phases. Disabled by default: while disabled,
+// ScopedPhase costs one branch and nothing is stored. Phases are summed up
+// by name, single runs are kept only for the trace.
+class Profiler {
+public:
+    Profiler();
+    void Enable();
+    bool IsEnabled() const;
+    void EnableTrace();
+    void Reset();
+    Clock::time_point GetOrigin() const;
+
+    // The process peak RSS so far is read at the end of the phase unless sample_rss is false
+    void RecordPhase(std::string_view name, std::string_view category, Clock::time_point start, Clock::time_point finish,
+                     bool sample_rss = true);
+    void AddCounter(std::string_view name, int64_t value);
+    void SetReportSection(std::string_view name, json::Node section);
+
+    json::Node BuildReport() const;
+    json::Node BuildChromeTrace() const;
+    void WriteReports(std::string_view report_file, std::string_view trace_file) const;
+
+private:
+    struct PhaseAggregate {
+        std::string category;
+        size_t order;
+        int calls = 0;
+        double total_us = 0;
+        double max_us = 0;
+        int64_t process_peak_rss_kb = -1;
+    };
+
+    size_t GetThreadIndex(std::thread::id id);
+
+    std::atomic<bool> enabled_ = false;
+    std::atomic<bool> trace_enabled_ = false;
+    Clock::time_point origin_;
+    mutable std::mutex mutex_;
+    std::map<std::string, PhaseAggregate, std::less<>> aggregates_;
+    std::vector<PhaseRecord> records_;
+    std::map<std::string, int64_t, std::less<>> counters_;
+    std::map<std::string, json::Node, std::less<>> sections_;
+    std::map<std::thread::id, size_t> thread_indexes_;
+};
+
+Profiler& GetProfiler();
+
+class ScopedPhase {
+public:
+    explicit ScopedPhase(std::string_view name, std::string_view category = "phase");
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+    ~ScopedPhase();
+
+private:
+    std::string name_;
+    std::string category_;
+    bool enabled_;
+    Clock::time_point start_;
+};
+
+} // end namespace profile
+} // end namespace transport
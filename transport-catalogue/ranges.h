@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <iterator>
 #include <string_view>
 #include <unordered_map>
@@ -28,6 +29,42 @@ private:
     It end_;
 };
 
+// Iterates over consecutive integers, so a range of ids needs no storage
+template <typename T>
+class CountingIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    explicit CountingIterator(T value)
+        : value_(value) {
+    }
+    reference operator*() const {
+        return value_;
+    }
+    CountingIterator& operator++() {
+        ++value_;
+        return *this;
+    }
+    CountingIterator operator++(int) {
+        CountingIterator old = *this;
+        ++value_;
+        return old;
+    }
+    bool operator==(const CountingIterator& other) const {
+        return value_ == other.value_;
+    }
+    bool operator!=(const CountingIterator& other) const {
+        return value_ != other.value_;
+    }
+
+private:
+    T value_;
+};
+
 template <typename C>
 auto AsRange(const C& container) {
     return Range{container.begin(), container.end()};
@@ -0,0 +1,178 @@
+#include "raptor.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace transport {
+
+namespace {
+
+constexpr double INFINITE_TIME = std::numeric_limits<double>::infinity();
+constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+} // namespace
+
+Raptor::Raptor(const TransportCatalogue& db, const SegmentDistance& get_distance)
+    : db_(&db) {
+    line_offsets_.push_back(0);
+    auto add_line = [&](const Bus& bus, const RouteView& route, size_t start, size_t finish) {
+        if (finish - start < 2) {
+            return;
+        }
+        for (size_t i = start; i < finish; ++i) {
+            line_stops_.push_back(static_cast<uint32_t>(route[i]->id));
+            line_distances_.push_back(i == start ? 0.0 : get_distance(route[i - 1], route[i]));
+        }
+        line_buses_.push_back(static_cast<uint32_t>(bus.id));
+        line_offsets_.push_back(static_cast<uint32_t>(line_stops_.size()));
+    };
+    for (const Bus& bus : db.GetBuses()) {
+        const RouteView route = bus.GetRoute();
+        const size_t size = route.size();
+        if (size == 0) {
+            continue;
+        }
+        if (bus.is_roundtrip) {
+            add_line(bus, route, 0, size);
+        } else { // the same halves as in the routing graph
+            add_line(bus, route, 0, (size + 1) / 2);
+            add_line(bus, route, (size - 1) / 2, size);
+        }
+    }
+
+    stop_offsets_.assign(db.GetStops().size() + 1, 0);
+    for (uint32_t stop : line_stops_) {
+        ++stop_offsets_[stop + 1];
+    }
+    std::partial_sum(stop_offsets_.begin(), stop_offsets_.end(), stop_offsets_.begin());
+    stop_lines_.resize(line_stops_.size());
+    std::vector<uint32_t> next(stop_offsets_.begin(), stop_offsets_.end() - 1);
+    for (uint32_t line = 0; line < line_buses_.size(); ++line) {
+        for (uint32_t position = line_offsets_[line]; position < line_offsets_[line + 1]; ++position) {
+            stop_lines_[next[line_stops_[position]]++] = {line, position};
+        }
+    }
+}
+
+bool Raptor::IsEmpty() const {
+    return db_ == nullptr;
+}
+
+std::vector<Journey> Raptor::FindJourneys(size_t from_stop_id, size_t to_stop_id, const RouterSettings& settings) const {
+    if (db_ == nullptr) {
+        throw std::logic_error("Raptor is not initialized");
+    }
+    if (from_stop_id == to_stop_id) {
+        return {Journey{0, {}}};
+    }
+    const size_t stop_count = stop_offsets_.size() - 1;
+    const double wait_time = static_cast<double>(settings.bus_wait_time);
+    std::vector<double> arrivals(stop_count, INFINITE_TIME); // best so far
+    std::vector<double> round_arrivals(stop_count, INFINITE_TIME); // best with fewer rides than in this round
+    std::vector<uint32_t> last_updates(stop_count, NONE);
+    std::vector<Update> updates;
+    std::vector<uint32_t> first_positions(line_buses_.size(), NONE);
+    std::vector<uint32_t> lines;
+    std::vector<bool> is_marked(stop_count, false);
+    std::vector<size_t> marked = {from_stop_id};
+    arrivals[from_stop_id] = 0;
+
+    for (uint32_t round = 1; !marked.empty(); ++round) {
+        // every line is scanned from the first stop improved in the previous round
+        for (size_t stop : marked) {
+            is_marked[stop] = false;
+            round_arrivals[stop] = arrivals[stop];
+            for (uint32_t i = stop_offsets_[stop]; i < stop_offsets_[stop + 1]; ++i) {
+                const StopLine& stop_line = stop_lines_[i];
+                if (first_positions[stop_line.line] == NONE) {
+                    lines.push_back(stop_line.line);
+                }
+                first_positions[stop_line.line] = std::min(first_positions[stop_line.line], stop_line.position);
+            }
+        }
+        marked.clear();
+        std::sort(lines.begin(), lines.end());
+
+        for (uint32_t line : lines) {
+            bool boarded = false;
+            uint32_t board_position = 0;
+            double board_time = 0;
+            double distance = 0;
+            for (uint32_t position = first_positions[line]; position < line_offsets_[line + 1]; ++position) {
+                const uint32_t stop = line_stops_[position];
+                double time = INFINITE_TIME;
+                if (boarded) {
+                    // accumulated from the boarding stop like the weight of a graph edge
+                    distance += line_distances_[position];
+                    time = board_time + TransportRouter::ComputeEdgeWeight(settings, distance);
+                    if (time < arrivals[stop] && time < arrivals[to_stop_id]) {
+                        arrivals[stop] = time;
+                        updates.push_back({round, line, board_position, position, time, last_updates[stop]});
+                        last_updates[stop] = static_cast<uint32_t>(updates.size() - 1);
+                        if (!is_marked[stop]) {
+                            is_marked[stop] = true;
+                            marked.push_back(stop);
+                        }
+                    }
+                }
+                // boarding here is better if it saves time on the rest of the line
+                if (round_arrivals[stop] != INFINITE_TIME && round_arrivals[stop] + wait_time < time) {
+                    boarded = true;
+                    board_position = position;
+                    board_time = round_arrivals[stop];
+                    distance = 0;
+                }
+            }
+            first_positions[line] = NONE;
+        }
+        lines.clear();
+    }
+
+    // the best update of every round at the target, rounds in increasing order
+    std::vector<uint32_t> best_updates;
+    for (uint32_t index = last_updates[to_stop_id]; index != NONE; index = updates[index].previous) {
+        if (best_updates.empty() || updates[best_updates.back()].round != updates[index].round) {
+            best_updates.push_back(index);
+        }
+    }
+    std::vector<Journey> journeys;
+    for (auto it = best_updates.rbegin(); it != best_updates.rend(); ++it) {
+        journeys.push_back(BuildJourney(updates, last_updates, from_stop_id, *it, settings));
+    }
+    return journeys;
+}
+
+Journey Raptor::BuildJourney(const std::vector<Update>& updates, const std::vector<uint32_t>& last_updates,
+                             size_t from_stop_id, uint32_t update_index, const RouterSettings& settings) const {
+    const double wait_time = static_cast<double>(settings.bus_wait_time);
+    Journey journey{updates[update_index].time, {}};
+    while (true) {
+        const Update& update = updates[update_index];
+        double distance = 0;
+        for (uint32_t position = update.board_position + 1; position <= update.alight_position; ++position) {
+            distance += line_distances_[position];
+        }
+        const size_t board_stop = line_stops_[update.board_position];
+        journey.legs.push_back({db_->GetStopById(board_stop), db_->GetBusById(line_buses_[update.line]),
+                                static_cast<int>(update.alight_position - update.board_position), wait_time,
+                                TransportRouter::ComputeEdgeWeight(settings, distance) - wait_time});
+        if (board_stop == from_stop_id) {
+            break;
+        }
+        // the boarding stop was reached in an earlier round
+        update_index = last_updates[board_stop];
+        while (update_index != NONE && updates[update_index].round >= update.round) {
+            update_index = updates[update_index].previous;
+        }
+        if (update_index == NONE) {
+            throw std::logic_error("Broken RAPTOR journey");
+        }
+    }
+    std::reverse(journey.legs.begin(), journey.legs.end());
+    return journey;
+}
+
+} // end namespace transport
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "domain.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace transport {
+
+struct RouterSettings;
+
+// Round-based router over bus lines (RAPTOR). Round k finds the fastest
+// journeys with k rides by scanning every line that serves a stop improved in
+// round k - 1, so no graph of stop pairs is needed. A line is the stop sequence
+// of a roundtrip bus or either half of a bus going there and back.
+class Raptor {
+public:
+    using SegmentDistance = std::function<double(const Stop* from, const Stop* to)>;
+
+    Raptor() = default;
+    Raptor(const TransportCatalogue& db, const SegmentDistance& get_distance);
+
+    bool IsEmpty() const;
+    // Journeys that are faster than any journey with fewer rides, in the order of
+    // rides; the last one is the fastest. Empty if `to` can't be reached.
+    std::vector<Journey> FindJourneys(size_t from_stop_id, size_t to_stop_id, const RouterSettings& settings) const;
+
+private:
+    struct StopLine {
+        uint32_t line;
+        uint32_t position;
+    };
+    struct Update {
+        uint32_t round;
+        uint32_t line;
+        uint32_t board_position;
+        uint32_t alight_position;
+        double time;
+        uint32_t previous; // earlier update of the same stop
+    };
+
+    Journey BuildJourney(const std::vector<Update>& updates, const std::vector<uint32_t>& last_updates,
+                         size_t from_stop_id, uint32_t update_index, const RouterSettings& settings) const;
+
+    const TransportCatalogue* db_ = nullptr;
+    // stops of line l and distances from the previous stop are [line_offsets_[l], line_offsets_[l + 1])
+    std::vector<uint32_t> line_offsets_;
+    std::vector<uint32_t> line_stops_;
+    std::vector<double> line_distances_;
+    std::vector<uint32_t> line_buses_;
+    // lines through stop s with positions are [stop_offsets_[s], stop_offsets_[s + 1])
+    std::vector<uint32_t> stop_offsets_;
+    std::vector<StopLine> stop_lines_;
+};
+
+} // end namespace transport
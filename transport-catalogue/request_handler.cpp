@@ -25,11 +25,40 @@ std::optional<std::unordered_set<std::string_view>> RequestHandler::GetBusesBySt
         if (stop_to_buses.at(stop_name).size() == 0) {
             return std::unordered_set<std::string_view>{};
         }
-        return stop_to_buses.at(stop_name);
+        const auto& buses = stop_to_buses.at(stop_name);
+        return std::unordered_set<std::string_view>(buses.begin(), buses.end());
     }
 }
+
+std::optional<std::vector<std::string_view>> RequestHandler::GetDirectBuses(const std::string_view& from,
+                                                                            const std::string_view& to) const {
+    const Stop* from_ptr = db_.FindStop(from);
+    const Stop* to_ptr = db_.FindStop(to);
+    if (from_ptr == nullptr || to_ptr == nullptr) {
+        return std::nullopt;
+    }
+    std::vector<std::string_view> names;
+    for (size_t bus_id : db_.GetStopBusIndex().GetCommonBuses(from_ptr->id, to_ptr->id)) {
+        names.push_back(db_.GetBusById(bus_id)->name);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+std::optional<std::vector<std::string_view>> RequestHandler::GetDirectStops(const std::string_view& stop_name) const {
+    const Stop* stop = db_.FindStop(stop_name);
+    if (stop == nullptr) {
+        return std::nullopt;
+    }
+    std::vector<std::string_view> names;
+    for (size_t stop_id : db_.GetStopBusIndex().GetDirectStops(stop->id)) {
+        names.push_back(db_.GetStopById(stop_id)->name);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
     
-svg::Document RequestHandler::RenderMap() const {
+svg::Document RequestHandler::RenderMap(std::pmr::memory_resource* resource) const {
 
     const auto& buses = db_.GetBuses();
     std::vector<const Bus*> bus_ptrs;
@@ -43,7 +72,7 @@ svg::Document RequestHandler::RenderMap() const {
                  return lhs->name < rhs->name;
              });
 
-    return renderer_.RenderMap(bus_ptrs);
+    return renderer_.RenderMap(bus_ptrs, resource);
 }
 
 
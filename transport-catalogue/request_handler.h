@@ -4,6 +4,7 @@
 #include "map_renderer.h"
 
 #include <optional>
+#include <vector>
 
 namespace transport {
     
@@ -16,7 +17,13 @@ public:
 
     std::optional<std::unordered_set<std::string_view>> GetBusesByStop(const std::string_view& stop_name) const;
 
-    svg::Document RenderMap() const;
+    // Names of the buses through both stops sorted by name, nullopt if a stop is unknown
+    std::optional<std::vector<std::string_view>> GetDirectBuses(const std::string_view& from, const std::string_view& to) const;
+
+    // Names of the stops reachable without a transfer sorted by name, nullopt if the stop is unknown
+    std::optional<std::vector<std::string_view>> GetDirectStops(const std::string_view& stop_name) const;
+
+    svg::Document RenderMap(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
 
 private:
     const TransportCatalogue& db_;
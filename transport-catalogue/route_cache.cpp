@@ -0,0 +1,86 @@
+#include "route_cache.h"
+
+#include <algorithm>
+
+namespace transport {
+
+RouteCache::RouteCache(size_t capacity, size_t shard_count)
+    : capacity_(capacity)
+    , shard_capacity_(0)
+    , shards_(std::max<size_t>(1, std::min(shard_count, capacity))) {
+    // rounded up, so the shards together hold at least capacity entries
+    shard_capacity_ = (capacity_ + shards_.size() - 1) / shards_.size();
+}
+
+uint64_t RouteCache::MakeKey(size_t from_id, size_t to_id) {
+    return (static_cast<uint64_t>(from_id) << 32) ^ static_cast<uint64_t>(to_id);
+}
+
+RouteCache::Shard& RouteCache::GetShard(uint64_t key) {
+    // splitmix64 finalizer: neighbouring ids land in different shards
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return shards_[key % shards_.size()];
+}
+
+RouteCache::Value RouteCache::Find(size_t from_id, size_t to_id) {
+    if (shard_capacity_ == 0) {
+        return nullptr;
+    }
+    const uint64_t key = MakeKey(from_id, to_id);
+    Shard& shard = GetShard(key);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        return nullptr;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    return it->second->second;
+}
+
+void RouteCache::Insert(size_t from_id, size_t to_id, Value value) {
+    if (shard_capacity_ == 0) {
+        return;
+    }
+    const uint64_t key = MakeKey(from_id, to_id);
+    Shard& shard = GetShard(key);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        it->second->second = std::move(value);
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return;
+    }
+    if (shard.entries.size() == shard_capacity_) {
+        shard.index.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+    }
+    shard.entries.emplace_front(key, std::move(value));
+    shard.index.emplace(key, shard.entries.begin());
+}
+
+void RouteCache::Clear() {
+    for (Shard& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        shard.index.clear();
+        shard.entries.clear();
+    }
+}
+
+size_t RouteCache::GetCapacity() const {
+    return capacity_;
+}
+
+size_t RouteCache::GetSize() const {
+    size_t size = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        size += shard.entries.size();
+    }
+    return size;
+}
+
+} // end namespace transport
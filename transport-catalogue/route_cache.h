@@ -0,0 +1,55 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace transport {
+
+// Bounded LRU cache of Route responses keyed by the stop ids of the request.
+// Entries are spread over independently locked shards, so threads answering
+// different pairs rarely wait for each other. Values are shared and immutable:
+// a reader copies the fragment after the shard lock is released.
+class RouteCache {
+public:
+    // Response without request_id: total_time and items, or error_message
+    using Value = std::shared_ptr<const json::Dict>;
+
+    explicit RouteCache(size_t capacity = DEFAULT_CAPACITY, size_t shard_count = DEFAULT_SHARD_COUNT);
+    RouteCache(const RouteCache&) = delete;
+    RouteCache& operator=(const RouteCache&) = delete;
+
+    // nullptr if the pair isn't cached, a found entry becomes the most recent
+    Value Find(size_t from_id, size_t to_id);
+    // Evicts the least recently used entry of the shard when it is full
+    void Insert(size_t from_id, size_t to_id, Value value);
+    void Clear();
+
+    size_t GetCapacity() const;
+    size_t GetSize() const;
+
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+    static constexpr size_t DEFAULT_SHARD_COUNT = 16;
+
+private:
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<std::pair<uint64_t, Value>> entries; // most recent first
+        std::unordered_map<uint64_t, std::list<std::pair<uint64_t, Value>>::iterator> index;
+    };
+
+    static uint64_t MakeKey(size_t from_id, size_t to_id);
+    Shard& GetShard(uint64_t key);
+
+    size_t capacity_;
+    size_t shard_capacity_;
+    std::vector<Shard> shards_;
+};
+
+} // end namespace transport
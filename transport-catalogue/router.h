@@ -6,6 +6,7 @@
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <numeric>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -16,6 +17,9 @@
 
 namespace graph {
 
+// All-pairs shortest paths. There are no paths between weakly connected
+// components, so every component gets its own dense table and memory is the
+// sum of squared component sizes rather than the square of the vertex count.
 template <typename Weight>
 class Router {
 private:
@@ -23,6 +27,13 @@ private:
 
 public:
     explicit Router(const Graph& graph);
+    // Vertices are used as intermediate ones in the order of through_ranks,
+    // which decides between equally short paths; by default in id order
+    Router(const Graph& graph, const std::vector<size_t>& through_ranks);
+    // Takes the tables of the components whose vertices and edges (targets and weights
+    // in incidence order) are the same as in the previous router's graph, computes the
+    // others. The result is the same as without the previous router.
+    Router(const Graph& graph, const std::vector<size_t>& through_ranks, const Router& previous);
     Router(const Graph& graph, const router_serialize::RoutesInternalData& data);
 
     struct RouteInfo {
@@ -31,9 +42,15 @@ public:
     };
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    // Vertices reachable from `from` with weight not above max_weight, in vertex order
+    std::vector<std::pair<VertexId, Weight>> GetReachable(VertexId from, Weight max_weight) const;
 
     router_serialize::RoutesInternalData SerializeRoutesInternalData() const;
     const Graph& GetGraph() const;
+    // Components of more than one vertex whose tables were taken from the previous
+    // router or computed anew; single vertices have nothing to compute
+    size_t GetReusedComponentCount() const;
+    size_t GetRecomputedComponentCount() const;
 
 private:
     struct RouteInternalData {
@@ -42,16 +59,37 @@ private:
     };
     using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
 
-    void InitializeRoutesInternalData(const Graph& graph) {
-        const size_t vertex_count = graph.GetVertexCount();
+    struct Component {
+        std::vector<VertexId> vertices; // in increasing order, position is the local index
+        RoutesInternalData routes_internal_data;
+    };
+
+    void InitializeComponents(const std::vector<size_t>& vertex_components) {
+        const size_t vertex_count = vertex_components.size();
+        vertex_components_ = vertex_components;
+        local_indices_.resize(vertex_count);
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
-            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            if (vertex_components_[vertex] >= components_.size()) {
+                components_.resize(vertex_components_[vertex] + 1);
+            }
+            auto& vertices = components_[vertex_components_[vertex]].vertices;
+            local_indices_[vertex] = vertices.size();
+            vertices.push_back(vertex);
+        }
+    }
+
+    void InitializeRoutesInternalData(const Graph& graph, Component& component) {
+        const size_t vertex_count = component.vertices.size();
+        auto& routes_internal_data = component.routes_internal_data;
+        routes_internal_data.assign(vertex_count, std::vector<std::optional<RouteInternalData>>(vertex_count));
+        for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+            routes_internal_data[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+            for (const EdgeId edge_id : graph.GetIncidentEdges(component.vertices[vertex])) {
                 const auto& edge = graph.GetEdge(edge_id);
                 if (edge.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
+                auto& route_internal_data = routes_internal_data[vertex][local_indices_[edge.to]];
                 if (!route_internal_data || route_internal_data->weight > edge.weight) {
                     route_internal_data = RouteInternalData{edge.weight, edge_id};
                 }
@@ -59,9 +97,64 @@ private:
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
+    void ComputeRoutesInternalData(const Graph& graph, Component& component, const std::vector<size_t>& through_ranks,
+                                   std::vector<size_t>& through_order) {
+        InitializeRoutesInternalData(graph, component);
+        const size_t vertex_count = component.vertices.size();
+        through_order.resize(vertex_count);
+        std::iota(through_order.begin(), through_order.end(), 0);
+        if (through_ranks.size() == graph.GetVertexCount()) {
+            std::sort(through_order.begin(), through_order.end(), [&](size_t lhs, size_t rhs) {
+                return through_ranks[component.vertices[lhs]] < through_ranks[component.vertices[rhs]];
+            });
+        }
+        for (size_t vertex_through : through_order) {
+            RelaxRoutesInternalDataThroughVertex(component.routes_internal_data, vertex_count, vertex_through);
+        }
+    }
+
+    // Copies the table of the same component of the previous router with edge ids
+    // moved to the new graph, false if the component or its edges differ
+    bool TryReuseRoutesInternalData(const Graph& graph, Component& component, const Router& previous) const {
+        const Graph& previous_graph = previous.graph_;
+        if (previous_graph.GetVertexCount() != graph.GetVertexCount() || component.vertices.empty()) {
+            return false;
+        }
+        const Component& previous_component = previous.components_[previous.vertex_components_[component.vertices.front()]];
+        if (previous_component.vertices != component.vertices) {
+            return false;
+        }
+        for (VertexId vertex : component.vertices) {
+            const auto edges = graph.GetIncidentEdges(vertex);
+            const auto previous_edges = previous_graph.GetIncidentEdges(vertex);
+            if (*edges.end() - *edges.begin() != *previous_edges.end() - *previous_edges.begin()) {
+                return false;
+            }
+            for (auto it = edges.begin(), previous_it = previous_edges.begin(); it != edges.end(); ++it, ++previous_it) {
+                const auto& edge = graph.GetEdge(*it);
+                const auto& previous_edge = previous_graph.GetEdge(*previous_it);
+                if (edge.to != previous_edge.to || edge.weight != previous_edge.weight) {
+                    return false;
+                }
+            }
+        }
+        component.routes_internal_data = previous_component.routes_internal_data;
+        for (auto& row : component.routes_internal_data) {
+            for (auto& route : row) {
+                if (route && route->prev_edge) {
+                    // same position among the edges of the same vertex
+                    const VertexId from = previous_graph.GetEdge(*route->prev_edge).from;
+                    route->prev_edge = *graph.GetIncidentEdges(from).begin()
+                        + (*route->prev_edge - *previous_graph.GetIncidentEdges(from).begin());
+                }
+            }
+        }
+        return true;
+    }
+
+    static void RelaxRoute(RoutesInternalData& routes_internal_data, size_t vertex_from, size_t vertex_to,
+                           const RouteInternalData& route_from, const RouteInternalData& route_to) {
+        auto& route_relaxing = routes_internal_data[vertex_from][vertex_to];
         const Weight candidate_weight = route_from.weight + route_to.weight;
         if (!route_relaxing || candidate_weight < route_relaxing->weight) {
             route_relaxing = {candidate_weight,
@@ -69,67 +162,127 @@ private:
         }
     }
 
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+    static void RelaxRoutesInternalDataThroughVertex(RoutesInternalData& routes_internal_data, size_t vertex_count,
+                                                     size_t vertex_through) {
+        for (size_t vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
+            if (const auto& route_from = routes_internal_data[vertex_from][vertex_through]) {
+                for (size_t vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
+                    if (const auto& route_to = routes_internal_data[vertex_through][vertex_to]) {
+                        RelaxRoute(routes_internal_data, vertex_from, vertex_to, *route_from, *route_to);
                     }
                 }
             }
         }
     }
 
+    static std::optional<RouteInternalData> DeserializeRouteInternalData(const router_serialize::OptInternalData& data) {
+        if (data.data_size() == 0) {
+            return std::nullopt;
+        }
+        const auto& v = data.data(0);
+        RouteInternalData i_d;
+        i_d.weight = v.weight();
+        if (v.prev_edge_size() != 0) {
+            i_d.prev_edge = v.prev_edge(0);
+        } else {
+            i_d.prev_edge = std::nullopt;
+        }
+        return i_d;
+    }
+
     static constexpr Weight ZERO_WEIGHT{};
     const Graph& graph_;
-    RoutesInternalData routes_internal_data_;
+    std::vector<size_t> vertex_components_;
+    std::vector<size_t> local_indices_;
+    std::vector<Component> components_;
+    size_t reused_component_count_ = 0;
+    size_t recomputed_component_count_ = 0;
 };
 
 template <typename Weight>
 Router<Weight>::Router(const Graph& graph)
+    : Router(graph, std::vector<size_t>{})
+{
+}
+
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, const std::vector<size_t>& through_ranks)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
 {
-    InitializeRoutesInternalData(graph);
+    InitializeComponents(ComputeWeakComponents(graph));
+    // through vertices go in the same order as with a single table, so the
+    // results, ties included, are the same
+    std::vector<size_t> through_order;
+    for (Component& component : components_) {
+        ComputeRoutesInternalData(graph, component, through_ranks, through_order);
+    }
+}
 
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, const std::vector<size_t>& through_ranks, const Router& previous)
+    : graph_(graph)
+{
+    InitializeComponents(ComputeWeakComponents(graph));
+    std::vector<size_t> through_order;
+    for (Component& component : components_) {
+        const bool trivial = component.vertices.size() < 2;
+        if (TryReuseRoutesInternalData(graph, component, previous)) {
+            reused_component_count_ += trivial ? 0 : 1;
+        } else {
+            ComputeRoutesInternalData(graph, component, through_ranks, through_order);
+            recomputed_component_count_ += trivial ? 0 : 1;
+        }
     }
 }
 
 template <typename Weight>
 Router<Weight>::Router(const Graph& graph, const router_serialize::RoutesInternalData& data)
     : graph_(graph) {
-    for(int i = 0; i < data.items_size(); ++i) {
-        std::vector<std::optional<RouteInternalData>> v;
-        for (int j = 0; j < data.items(i).items_size(); ++j) {
-            std::optional<RouteInternalData> opt_i_d;
-            if(data.items(i).items(j).data_size() != 0) {
-                RouteInternalData i_d;
-                const auto& v = data.items(i).items(j).data(0);
-                i_d.weight = v.weight();
-                if (v.prev_edge_size() != 0) {
-                    i_d.prev_edge = v.prev_edge(0);
-                } else {
-                    i_d.prev_edge = std::nullopt;
+    if (data.components_size() == 0) {
+        // older file with one table for the whole graph
+        InitializeComponents(ComputeWeakComponents(graph));
+        for (Component& component : components_) {
+            const size_t vertex_count = component.vertices.size();
+            component.routes_internal_data.assign(vertex_count, std::vector<std::optional<RouteInternalData>>(vertex_count));
+            for (size_t i = 0; i < vertex_count; ++i) {
+                const auto& row = data.items(static_cast<int>(component.vertices[i]));
+                for (size_t j = 0; j < vertex_count; ++j) {
+                    component.routes_internal_data[i][j] =
+                        DeserializeRouteInternalData(row.items(static_cast<int>(component.vertices[j])));
                 }
-                opt_i_d = i_d;
-            } else {
-                opt_i_d = std::nullopt;
             }
-            v.push_back(std::move(opt_i_d));
         }
-        routes_internal_data_.push_back(std::move(v));
+        return;
+    }
+    std::vector<size_t> vertex_components(graph.GetVertexCount());
+    for (int c = 0; c < data.components_size(); ++c) {
+        for (uint32_t vertex : data.components(c).vertices()) {
+            vertex_components.at(vertex) = static_cast<size_t>(c);
+        }
+    }
+    InitializeComponents(vertex_components);
+    for (int c = 0; c < data.components_size(); ++c) {
+        const auto& table = data.components(c);
+        auto& routes_internal_data = components_[c].routes_internal_data;
+        for (int i = 0; i < table.items_size(); ++i) {
+            std::vector<std::optional<RouteInternalData>> v;
+            for (int j = 0; j < table.items(i).items_size(); ++j) {
+                v.push_back(DeserializeRouteInternalData(table.items(i).items(j)));
+            }
+            routes_internal_data.push_back(std::move(v));
+        }
     }
 }
 
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
+    if (vertex_components_.at(from) != vertex_components_.at(to)) {
+        return std::nullopt;
+    }
+    const Component& component = components_[vertex_components_[from]];
+    const auto& routes = component.routes_internal_data[local_indices_[from]];
+    const auto& route_internal_data = routes.at(local_indices_[to]);
     if (!route_internal_data) {
         return std::nullopt;
     }
@@ -137,7 +290,7 @@ std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(Ver
     std::vector<EdgeId> edges;
     for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
          edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+         edge_id = routes[local_indices_[graph_.GetEdge(*edge_id).from]]->prev_edge)
     {
         edges.push_back(*edge_id);
     }
@@ -146,28 +299,48 @@ std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(Ver
     return RouteInfo{weight, std::move(edges)};
 }
 
+template <typename Weight>
+std::vector<std::pair<VertexId, Weight>> Router<Weight>::GetReachable(VertexId from, Weight max_weight) const {
+    std::vector<std::pair<VertexId, Weight>> result;
+    const Component& component = components_[vertex_components_.at(from)];
+    const auto& row = component.routes_internal_data[local_indices_[from]];
+    for (size_t to = 0; to < row.size(); ++to) {
+        if (row[to] && !(max_weight < row[to]->weight)) {
+            result.push_back({component.vertices[to], row[to]->weight});
+        }
+    }
+    return result;
+}
+
 template<typename Weight>
 router_serialize::RoutesInternalData Router<Weight>::SerializeRoutesInternalData() const {
     router_serialize::RoutesInternalData d;
-    for (size_t i = 0; i < routes_internal_data_.size(); ++i) {
-        router_serialize::VectorOpt vector_opt;
-        for (size_t j = 0; j < routes_internal_data_.at(i).size(); ++j) {
-            router_serialize::OptInternalData opt_i_d;
-            if (routes_internal_data_.at(i).at(j).has_value()) {
-                const auto& v = *routes_internal_data_.at(i).at(j);
-                router_serialize::InternalData i_d;
-                i_d.set_weight(v.weight);
-                if (v.prev_edge.has_value()) {
-                    i_d.add_prev_edge(*v.prev_edge);
+    for (const Component& component : components_) {
+        router_serialize::ComponentTable table;
+        for (VertexId vertex : component.vertices) {
+            table.add_vertices(vertex);
+        }
+        for (size_t i = 0; i < component.routes_internal_data.size(); ++i) {
+            router_serialize::VectorOpt vector_opt;
+            for (size_t j = 0; j < component.routes_internal_data.at(i).size(); ++j) {
+                router_serialize::OptInternalData opt_i_d;
+                if (component.routes_internal_data.at(i).at(j).has_value()) {
+                    const auto& v = *component.routes_internal_data.at(i).at(j);
+                    router_serialize::InternalData i_d;
+                    i_d.set_weight(v.weight);
+                    if (v.prev_edge.has_value()) {
+                        i_d.add_prev_edge(*v.prev_edge);
+                    }
+                    opt_i_d.add_data();
+                    *opt_i_d.mutable_data(0) = std::move(i_d);
                 }
-                opt_i_d.add_data();
-                *opt_i_d.mutable_data(0) = std::move(i_d);
+                vector_opt.add_items();
+                *vector_opt.mutable_items((int)j) = std::move(opt_i_d);
             }
-            vector_opt.add_items();
-            *vector_opt.mutable_items((int)j) = std::move(opt_i_d);
+            table.add_items();
+            *table.mutable_items((int)i) = std::move(vector_opt);
         }
-        d.add_items();
-        *d.mutable_items((int)i) = std::move(vector_opt);
+        *d.add_components() = std::move(table);
     }
     return d;
 }
@@ -177,4 +350,14 @@ const DirectedWeightedGraph<Weight>& Router<Weight>::GetGraph() const {
     return graph_;
 }
 
+template<typename Weight>
+size_t Router<Weight>::GetReusedComponentCount() const {
+    return reused_component_count_;
+}
+
+template <typename Weight>
+size_t Router<Weight>::GetRecomputedComponentCount() const {
+    return recomputed_component_count_;
+}
+
 }  // namespace graph
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json_reader.h"
+#include "profiler.h"
+#include "serialization.h"
+#include "synthetic_city.h"
+
+using namespace std::literals;
+
+// Runs the whole make_base / process_requests pipeline on generated cities
+// of several sizes and prints the time of every stage and the mean and max
+// latency of every stat request type, as collected by profile::Profiler.
+
+namespace {
+
+struct BenchmarkOptions {
+    std::vector<size_t> sizes = {1000, 10000, 50000};
+    size_t max_router_stops = 3000;
+    size_t request_count = 3000;
+    bool prune_edges = true;
+    bool use_landmarks = true;
+    bool use_hub_labels = false;
+};
+
+std::string ToJsonText(const json::Document& document) {
+    std::ostringstream out;
+    json::Print(document, out);
+    return out.str();
+}
+
+void MakeBase(const std::string& input, bool precompute_routes, const BenchmarkOptions& options) {
+    transport::profile::Profiler& profiler = transport::profile::GetProfiler();
+    transport::TransportCatalogue catalogue;
+    transport::renderer::MapRenderer renderer;
+    transport::TransportRouter router(catalogue);
+    router.SetEdgePruning(options.prune_edges);
+    transport::RequestHandler handler(catalogue, renderer);
+    transport::io::JsonReader reader(catalogue, handler, renderer, router);
+
+    std::istringstream in(input);
+    auto parse_start = transport::profile::Clock::now();
+    reader.ReadJsonFromStream(in);
+    profiler.RecordPhase("json_parse", "phase", parse_start, transport::profile::Clock::now());
+    {
+        transport::profile::ScopedPhase phase("fill_db");
+        reader.FillDB();
+    }
+    transport::Serializer serializer(catalogue, renderer, router, reader);
+    reader.ProcessAndApplyRenderSettings();
+    reader.ProcessAndApplyRouterSettings();
+    if (!precompute_routes && options.use_hub_labels) {
+        router.SetBackend(transport::RoutingBackend::HUB_LABELS);
+    } else if (!precompute_routes && options.use_landmarks) {
+        router.SetBackend(transport::RoutingBackend::ALT);
+    }
+    serializer.SaveData(precompute_routes || options.use_landmarks || options.use_hub_labels);
+}
+
+void ProcessRequests(const std::string& input) {
+    transport::TransportCatalogue catalogue;
+    transport::renderer::MapRenderer renderer;
+    transport::TransportRouter router(catalogue);
+    transport::RequestHandler handler(catalogue, renderer);
+    transport::io::JsonReader reader(catalogue, handler, renderer, router);
+
+    std::istringstream in(input);
+    reader.ReadJsonFromStream(in);
+    transport::Serializer serializer(catalogue, renderer, router, reader);
+    {
+        transport::profile::ScopedPhase phase("load_data");
+        serializer.LoadData();
+    }
+    std::ostringstream out;
+    reader.ProcessStatRequests(out);
+}
+
+void PrintReport(const json::Node& report) {
+    std::cout << std::fixed << std::setprecision(3);
+    for (const auto& phase : report.AsDict().at("phases").AsArray()) {
+        const auto& p = phase.AsDict();
+        const std::string& name = p.at("name").AsString();
+        if (p.at("category").AsString() == "stat_request"sv) {
+            const auto& latency = report.AsDict().at("stat_request_latency").AsDict()
+                                        .at(name.substr("stat_request:"sv.size())).AsDict();
+            std::cout << "  " << std::left << std::setw(24) << name
+                      << " calls " << std::setw(6) << p.at("calls").AsInt()
+                      << " mean " << latency.at("mean_ms").AsDouble() << " ms"
+                      << "  p50 " << latency.at("p50_ms").AsDouble() << " ms"
+                      << "  p99 " << latency.at("p99_ms").AsDouble() << " ms"
+                      << "  max " << latency.at("max_ms").AsDouble() << " ms" << std::endl;
+        } else {
+            std::cout << "  " << std::left << std::setw(24) << name
+                      << std::setw(12) << p.at("total_ms").AsDouble() << " ms"
+                      << "  process peak rss " << static_cast<long long>(p.at("process_peak_rss_kb").AsDouble()) << " kB"
+                      << std::endl;
+        }
+    }
+    for (const auto& [name, value] : report.AsDict().at("counters").AsDict()) {
+        std::cout << "  " << std::left << std::setw(24) << name
+                  << static_cast<long long>(value.AsDouble()) << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+void RunSize(size_t stop_count, const BenchmarkOptions& options) {
+    transport::synthetic::CityParams params;
+    params.stop_count = stop_count;
+    params.bus_count = std::max<size_t>(1, stop_count / 10);
+    params.stat_request_count = options.request_count;
+    params.file = "scale_benchmark_"s + std::to_string(stop_count) + ".db"s;
+
+    const bool precompute_routes = stop_count <= options.max_router_stops;
+    const std::string make_base_input = ToJsonText(transport::synthetic::GenerateMakeBase(params));
+    const std::string process_requests_input = ToJsonText(transport::synthetic::GenerateProcessRequests(params));
+
+    transport::profile::GetProfiler().Reset();
+    MakeBase(make_base_input, precompute_routes, options);
+    ProcessRequests(process_requests_input);
+
+    std::cout << "stops " << params.stop_count << ", buses " << params.bus_count
+              << ", input " << make_base_input.size() / 1024 << " kB"
+              << ", snapshot " << std::filesystem::file_size(params.file) / 1024 << " kB";
+    if (!precompute_routes) {
+        std::cout << " (no route table, Route requests searched on demand"
+                  << (options.use_hub_labels ? " with hub labels" : options.use_landmarks ? " with landmarks" : "") << ", limit " << options.max_router_stops << " stops)";
+    }
+    std::cout << std::endl;
+    PrintReport(transport::profile::GetProfiler().BuildReport());
+    std::filesystem::remove(params.file);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        if (arg == "--max-router-stops"sv && i + 1 < argc) {
+            options.max_router_stops = std::stoul(argv[++i]);
+        } else if (arg == "--requests"sv && i + 1 < argc) {
+            options.request_count = std::stoul(argv[++i]);
+        } else if (arg == "--no-prune"sv) {
+            options.prune_edges = false;
+        } else if (arg == "--no-landmarks"sv) {
+            options.use_landmarks = false;
+        } else if (arg == "--hub-labels"sv) {
+            options.use_hub_labels = true;
+        } else if (!arg.empty() && std::isdigit(static_cast<unsigned char>(arg[0]))) {
+            sizes.push_back(std::stoul(std::string(arg)));
+        } else {
+            std::cerr << "Usage: scale_benchmark [stop counts...] [--max-router-stops N] [--requests N] [--no-prune] [--no-landmarks] [--hub-labels]" << std::endl;
+            return 1;
+        }
+    }
+    if (!sizes.empty()) {
+        options.sizes = sizes;
+    }
+
+    transport::profile::GetProfiler().Enable();
+    for (size_t size : options.sizes) {
+        RunSize(size, options);
+    }
+}
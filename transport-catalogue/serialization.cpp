@@ -1,40 +1,63 @@
 #include "serialization.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <future>
+#include <utility>
 
 namespace transport {
 
 Serializer::Serializer(TransportCatalogue& db, renderer::MapRenderer& renderer, TransportRouter& router, const io::JsonReader& reader)
+    : Serializer(db, renderer, router,
+                 reader.ProcessSerializationSettings().at("file").AsString(),
+                 reader.ProcessSerializationSettings().at("omit_derived").AsBool()) {
+}
+
+Serializer::Serializer(TransportCatalogue& db, renderer::MapRenderer& renderer, TransportRouter& router, std::string file, bool omit_derived)
     : db_(db)
     , renderer_(renderer)
     , router_(router)
-    , reader_(reader)
-    , file_(reader_.ProcessSerializationSettings().at("file").AsString()) {
+    , file_(std::move(file))
+    , omit_derived_(omit_derived) {
 }
 
-void Serializer::SaveData() {
+void Serializer::SaveData(bool init_router) {
     std::ofstream out(file_.c_str(), std::ios::binary);
     if (!out) {
         std::cerr << "Couldn't open output file " << file_ << ", not saving." << std::endl;
         return;
     }
+    // the catalogue and render sections don't depend on the router
+    auto sections = std::async(std::launch::async, [this]() {
+        profile::ScopedPhase phase("serialize_catalogue");
+        return std::make_pair(SerializeCatalogue(), SerializeRenderer());
+    });
+    if (init_router) {
+        router_.Init();
+    } else {
+        router_.InitGraph();
+    }
+    profile::ScopedPhase phase("save_data");
     transport_serialize::SaveData savedata;
-    *savedata.mutable_transport_catalogue() = std::move(SerializeCatalogue());
-    *savedata.mutable_render_settings() = std::move(SerializeRenderer());
     *savedata.mutable_graph() = std::move(SerializeGraph());
     *savedata.mutable_router_data() = std::move(SerializeRouter());
+    auto [catalogue, render_settings] = sections.get();
+    *savedata.mutable_transport_catalogue() = std::move(catalogue);
+    *savedata.mutable_render_settings() = std::move(render_settings);
 
     savedata.SerializeToOstream(&out);
 }
 
-void Serializer::LoadData() {
+bool Serializer::LoadData() {
     std::ifstream in(file_.c_str(), std::ios::binary);
     if (!in) {
         std::cerr << "Couldn't load input file " << file_ << ", no loading will be done." << std::endl;
-        return;
+        return false;
     }
     transport_serialize::SaveData savedata;
     if (!savedata.ParseFromIstream(&in)) {
         std::cerr << "Couldn't parse file." << std::endl;
-        return;
+        return false;
     }
 
     transport_serialize::TransportCatalogue catalogue = std::move(savedata.transport_catalogue());
@@ -45,17 +68,60 @@ void Serializer::LoadData() {
     DeserializeCatalogue(catalogue);
     DeserializeRenderer(render_settings);
     router_.ApplySettings({router_settings.bus_wait_time(), router_settings.bus_velocity()});
-    auto graph_ptr = std::make_unique<graph::DirectedWeightedGraph<double>>(graph);
-    auto router_ptr = std::make_unique<graph::Router<double>>(*graph_ptr, router_settings.data());
-    router_.SetPointers(std::move(graph_ptr), std::move(router_ptr));
+    router_.SetBackend(static_cast<RoutingBackend>(router_settings.backend()),
+                       router_settings.landmark_count() != 0 ? router_settings.landmark_count()
+                                                             : TransportRouter::DEFAULT_LANDMARK_COUNT);
+    if (std::all_of(graph.edges().begin(), graph.edges().end(), [](const auto& e) { return e.distance() == 0; })) {
+        // older file without edge distances, recover them from weights
+        for (auto& e : *graph.mutable_edges()) {
+            e.set_distance((e.weight() - router_settings.bus_wait_time()) * router_settings.bus_velocity() / 0.06);
+        }
+    }
+    std::vector<graph::EdgeId> new_edge_ids;
+    auto graph_ptr = std::make_unique<graph::DirectedWeightedGraph<double>>(graph, &new_edge_ids);
+    std::unique_ptr<graph::Router<double>> router_ptr;
+    if (router_settings.data().components_size() != 0 || router_settings.data().items_size() != 0) {
+        // the table is not saved if it wasn't built
+        if (!new_edge_ids.empty()) {
+            RenumberRouteEdges(*router_settings.mutable_data(), new_edge_ids);
+        }
+        router_ptr = std::make_unique<graph::Router<double>>(*graph_ptr, router_settings.data());
+    }
+    if (graph.offsets_size() == 0 && graph.incidence_lists_size() == 0 && router_.GetBackend() == RoutingBackend::RAPTOR) {
+        // saved without a graph, RAPTOR needs only the lines
+        router_.Init();
+    } else {
+        router_.SetPointers(std::move(graph_ptr), std::move(router_ptr),
+                            std::vector<size_t>(router_settings.stop_components().begin(), router_settings.stop_components().end()),
+                            std::vector<graph::VertexId>(router_settings.stop_vertices().begin(), router_settings.stop_vertices().end()));
+    }
+    if (router_settings.landmarks().vertices_size() != 0) {
+        const auto& landmarks = router_settings.landmarks();
+        router_.SetLandmarks(graph::Landmarks<double>(
+            std::vector<graph::VertexId>(landmarks.vertices().begin(), landmarks.vertices().end()),
+            std::vector<double>(landmarks.from_landmarks().begin(), landmarks.from_landmarks().end()),
+            std::vector<double>(landmarks.to_landmarks().begin(), landmarks.to_landmarks().end())));
+    }
+    if (router_settings.hub_labels().forward().offsets_size() != 0) {
+        router_.SetHubLabels(graph::HubLabels<double>(DeserializeLabelSet(router_settings.hub_labels().forward()),
+                                                      DeserializeLabelSet(router_settings.hub_labels().backward())));
+    }
+    return true;
 }
 
 transport_serialize::TransportCatalogue Serializer::SerializeCatalogue() {
     transport_serialize::TransportCatalogue c;
-    CatalogueSaveData savedata = std::move(db_.SaveData());
+    CatalogueSaveData savedata = std::move(db_.SaveData(omit_derived_));
+    c.set_derived_omitted(savedata.derived_omitted);
+    c.set_one_way_buses(true);
+    c.set_one_way_distances(savedata.one_way_distances);
+    c.set_name_pool(std::move(savedata.name_pool));
+    *c.mutable_stop_index() = SerializeNameIndex(savedata.stop_index);
+    *c.mutable_bus_index() = SerializeNameIndex(savedata.bus_index);
+    *c.mutable_stop_bus_index() = SerializeStopBusIndex(savedata.stop_bus_index);
 
     int i = 0;
-    for (const Stop& s : db_.GetStops()) {
+    for (const CatalogueSaveData::Stop& s : savedata.stops) {
         c.add_stops();
         *c.mutable_stops(i) = std::move(SerializeStop(s));
         ++i;
@@ -125,12 +191,42 @@ renderer_serialize::RenderSettings Serializer::SerializeRenderer() {
 }
 
 router_serialize::Graph Serializer::SerializeGraph() {
+    if (router_.GetBackend() != RoutingBackend::RAPTOR) {
+        router_.InitGraph();
+    }
+    if (!router_.HasGraph()) {
+        return {};
+    }
     return router_.GetGraph().SerializeGraph();
 }
 
 router_serialize::RouterSettings Serializer::SerializeRouter() {
     router_serialize::RouterSettings s;
-    *s.mutable_data() = std::move(router_.GetRouter().SerializeRoutesInternalData());
+    if (router_.HasRouter()) {
+        *s.mutable_data() = std::move(router_.GetRouter().SerializeRoutesInternalData());
+    }
+    for (size_t component : router_.GetComponents()) {
+        s.add_stop_components(component);
+    }
+    for (graph::VertexId vertex : router_.GetStopVertices()) {
+        s.add_stop_vertices(vertex);
+    }
+    const graph::Landmarks<double>& landmarks = router_.GetLandmarks();
+    if (!landmarks.IsEmpty()) {
+        router_serialize::Landmarks& l = *s.mutable_landmarks();
+        for (graph::VertexId vertex : landmarks.GetVertices()) {
+            l.add_vertices(vertex);
+        }
+        l.mutable_from_landmarks()->Add(landmarks.GetFromLandmarks().begin(), landmarks.GetFromLandmarks().end());
+        l.mutable_to_landmarks()->Add(landmarks.GetToLandmarks().begin(), landmarks.GetToLandmarks().end());
+    }
+    const graph::HubLabels<double>& hub_labels = router_.GetHubLabels();
+    if (!hub_labels.IsEmpty()) {
+        *s.mutable_hub_labels()->mutable_forward() = SerializeLabelSet(hub_labels.GetForwardLabels());
+        *s.mutable_hub_labels()->mutable_backward() = SerializeLabelSet(hub_labels.GetBackwardLabels());
+    }
+    s.set_backend(static_cast<uint32_t>(router_.GetBackend()));
+    s.set_landmark_count(static_cast<uint32_t>(router_.GetLandmarkCount()));
     s.set_bus_wait_time(router_.GetBusWaitTime());
     s.set_bus_velocity(router_.GetBusVelocity());
     return s;
@@ -156,6 +252,31 @@ void Serializer::DeserializeCatalogue(const transport_serialize::TransportCatalo
     for (int i = 0; i < c.bus_id_to_total_distances_size(); ++i) {
         s.bus_id_to_total_distances.push_back(std::move(DeserializeBusToTotal(c.bus_id_to_total_distances(i))));
     }
+    s.derived_omitted = c.derived_omitted();
+    s.one_way_distances = c.one_way_distances();
+    s.name_pool = c.name_pool();
+    s.stop_index = DeserializeNameIndex(c.stop_index());
+    s.bus_index = DeserializeNameIndex(c.bus_index());
+    s.stop_bus_index = DeserializeStopBusIndex(c.stop_bus_index());
+    if (s.name_pool.empty()) {
+        // older file with names stored inline
+        NamePool pool;
+        for (int i = 0; i < c.stops_size(); ++i) {
+            s.stops[i].name = pool.GetRef(pool.Intern(c.stops(i).name()));
+        }
+        for (int i = 0; i < c.buses_size(); ++i) {
+            s.buses[i].name = pool.GetRef(pool.Intern(c.buses(i).name()));
+        }
+        s.name_pool = pool.Save();
+    }
+    if (!c.one_way_buses()) {
+        // older file with the way back of non-roundtrip buses stored as well
+        for (CatalogueSaveData::Bus& bus : s.buses) {
+            if (!bus.is_roundtrip) {
+                bus.stop_ids.resize((bus.stop_ids.size() + 1) / 2);
+            }
+        }
+    }
 
     db_.LoadData(s);
 }
@@ -189,6 +310,42 @@ void Serializer::DeserializeRouter(const router_serialize::RoutesInternalData& d
 
 }
 
+router_serialize::LabelSet Serializer::SerializeLabelSet(const graph::HubLabels<double>::LabelSet& labels) {
+    router_serialize::LabelSet l;
+    l.mutable_offsets()->Add(labels.offsets.begin(), labels.offsets.end());
+    l.mutable_hubs()->Add(labels.hubs.begin(), labels.hubs.end());
+    l.mutable_weights()->Add(labels.weights.begin(), labels.weights.end());
+    l.mutable_parents()->Add(labels.parents.begin(), labels.parents.end());
+    return l;
+}
+
+graph::HubLabels<double>::LabelSet Serializer::DeserializeLabelSet(const router_serialize::LabelSet& labels) {
+    graph::HubLabels<double>::LabelSet l;
+    l.offsets.assign(labels.offsets().begin(), labels.offsets().end());
+    l.hubs.assign(labels.hubs().begin(), labels.hubs().end());
+    l.weights.assign(labels.weights().begin(), labels.weights().end());
+    l.parents.assign(labels.parents().begin(), labels.parents().end());
+    return l;
+}
+
+void Serializer::RenumberRouteEdges(router_serialize::RoutesInternalData& data, const std::vector<graph::EdgeId>& new_ids) {
+    auto renumber_rows = [&new_ids](auto& rows) {
+        for (auto& row : rows) {
+            for (auto& item : *row.mutable_items()) {
+                for (auto& d : *item.mutable_data()) {
+                    for (auto& edge_id : *d.mutable_prev_edge()) {
+                        edge_id = static_cast<uint32_t>(new_ids.at(edge_id));
+                    }
+                }
+            }
+        }
+    };
+    renumber_rows(*data.mutable_items());
+    for (auto& component : *data.mutable_components()) {
+        renumber_rows(*component.mutable_items());
+    }
+}
+
 ////////////////////////////////   Serialization / Deserialization of smaller parts  //////////////////////////
 
 renderer_serialize::Color Serializer::SerializeColor(svg::Color color) {
@@ -230,13 +387,14 @@ svg::Color Serializer::DeserializeColor(renderer_serialize::Color color) {
     }
 }
 
-transport_serialize::Stop Serializer::SerializeStop(const Stop& stop) {
+transport_serialize::Stop Serializer::SerializeStop(const CatalogueSaveData::Stop& stop) {
     transport_serialize::Stop result;
     transport_serialize::Coordinates coords;
     coords.set_lat(stop.coordinates.lat);
     coords.set_lng(stop.coordinates.lng);
     *result.mutable_coordinates() = std::move(coords);
-    result.set_name(stop.name);
+    result.set_name_offset(stop.name.offset);
+    result.set_name_length(stop.name.length);
     result.set_id(stop.id);
     return result;
 }
@@ -244,7 +402,8 @@ transport_serialize::Stop Serializer::SerializeStop(const Stop& stop) {
 transport_serialize::Bus Serializer::SerializeBus(const CatalogueSaveData::Bus& bus) {
     transport_serialize::Bus result;
     result.set_id(bus.id);
-    result.set_name(bus.name);
+    result.set_name_offset(bus.name.offset);
+    result.set_name_length(bus.name.length);
     for(size_t id: bus.stop_ids) {
         result.add_stop_ids(id);
     }
@@ -285,10 +444,30 @@ transport_serialize::BusToTotal Serializer::SerializeBusToTotal(const CatalogueS
     return r;
 }
 
-Stop Serializer::DeserializeStop(const transport_serialize::Stop& stop) {
-    Stop r;
+transport_serialize::NameIndex Serializer::SerializeNameIndex(const PerfectHashIndex& index) {
+    transport_serialize::NameIndex r;
+    r.set_salt(index.GetSalt());
+    for (uint32_t seed : index.GetSeeds()) {
+        r.add_seeds(seed);
+    }
+    for (uint32_t id : index.GetIds()) {
+        r.add_ids(id);
+    }
+    return r;
+}
+
+transport_serialize::StopBusIndex Serializer::SerializeStopBusIndex(const StopBusIndex& index) {
+    transport_serialize::StopBusIndex r;
+    r.set_stop_count(static_cast<uint32_t>(index.GetStopCount()));
+    r.set_bus_count(static_cast<uint32_t>(index.GetBusCount()));
+    r.mutable_stop_buses()->Add(index.GetStopBuses().begin(), index.GetStopBuses().end());
+    return r;
+}
+
+CatalogueSaveData::Stop Serializer::DeserializeStop(const transport_serialize::Stop& stop) {
+    CatalogueSaveData::Stop r;
     r.id = stop.id();
-    r.name = stop.name();
+    r.name = {stop.name_offset(), stop.name_length()};
     r.coordinates = {stop.coordinates().lat(), stop.coordinates().lng()};
     return r;
 }
@@ -296,7 +475,7 @@ Stop Serializer::DeserializeStop(const transport_serialize::Stop& stop) {
 CatalogueSaveData::Bus Serializer::DeserializeBus(const transport_serialize::Bus& bus) {
     CatalogueSaveData::Bus r;
     r.id = bus.id();
-    r.name = bus.name();
+    r.name = {bus.name_offset(), bus.name_length()};
     r.is_roundtrip = bus.is_roundtrip();
     for (int i = 0; i < bus.stop_ids_size(); ++i) {
         r.stop_ids.push_back(bus.stop_ids(i));
@@ -337,4 +516,19 @@ CatalogueSaveData::BusToTotal Serializer::DeserializeBusToTotal(const transport_
     return r;
 }
 
+PerfectHashIndex Serializer::DeserializeNameIndex(const transport_serialize::NameIndex& index) {
+    return PerfectHashIndex(index.salt(),
+                            std::vector<uint32_t>(index.seeds().begin(), index.seeds().end()),
+                            std::vector<uint32_t>(index.ids().begin(), index.ids().end()));
+}
+
+StopBusIndex Serializer::DeserializeStopBusIndex(const transport_serialize::StopBusIndex& index) {
+    const size_t stop_count = index.stop_count();
+    const size_t bus_count = index.bus_count();
+    if (static_cast<size_t>(index.stop_buses_size()) != stop_count * StopBusIndex::GetWordCount(bus_count)) {
+        return {}; // missing or damaged, rebuilt by the catalogue
+    }
+    return StopBusIndex(stop_count, bus_count, std::vector<uint64_t>(index.stop_buses().begin(), index.stop_buses().end()));
+}
+
 } // end namespace transport
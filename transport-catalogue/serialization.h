@@ -9,20 +9,28 @@
 #include <transport_router.pb.h>
 
 #include <fstream>
+#include <vector>
 
 namespace transport {
 
 class Serializer {
 public:
     Serializer(TransportCatalogue& db, renderer::MapRenderer& renderer, TransportRouter& router, const io::JsonReader& reader);
-    void SaveData();
-    void LoadData();
+    Serializer(TransportCatalogue& db, renderer::MapRenderer& renderer, TransportRouter& router, std::string file, bool omit_derived = false);
+    // Runs router Init() (only InitGraph() unless init_router) while the catalogue
+    // and render sections are serialized on another thread
+    void SaveData(bool init_router = true);
+    bool LoadData();
 
 private:
     router_serialize::Graph SerializeGraph();
     router_serialize::RouterSettings SerializeRouter();
     void DeserializeGraph(const router_serialize::Graph& graph);
     void DeserializeRouter(const router_serialize::RoutesInternalData& data);
+    // Older files store the table with edge ids from before the graph was packed
+    router_serialize::LabelSet SerializeLabelSet(const graph::HubLabels<double>::LabelSet& labels);
+    graph::HubLabels<double>::LabelSet DeserializeLabelSet(const router_serialize::LabelSet& labels);
+    void RenumberRouteEdges(router_serialize::RoutesInternalData& data, const std::vector<graph::EdgeId>& new_ids);
 
     transport_serialize::TransportCatalogue SerializeCatalogue();
     renderer_serialize::RenderSettings SerializeRenderer();
@@ -32,25 +40,29 @@ private:
     renderer_serialize::Color SerializeColor(svg::Color color);
     svg::Color DeserializeColor(renderer_serialize::Color color);
 
-    transport_serialize::Stop SerializeStop(const Stop& stop);
+    transport_serialize::Stop SerializeStop(const CatalogueSaveData::Stop& stop);
     transport_serialize::Bus SerializeBus(const CatalogueSaveData::Bus& bus);
     transport_serialize::StopToBuses SerializeStopToBuses(const CatalogueSaveData::StopToBuses& stb);
     transport_serialize::Distance SerializeDistance(const CatalogueSaveData::Distance& dist);
     transport_serialize::GeoDistance SerializeGeoDistance(const CatalogueSaveData::GeoDistance& dist);
     transport_serialize::BusToTotal SerializeBusToTotal(const CatalogueSaveData::BusToTotal& dist);
+    transport_serialize::NameIndex SerializeNameIndex(const PerfectHashIndex& index);
+    transport_serialize::StopBusIndex SerializeStopBusIndex(const StopBusIndex& index);
 
-    Stop DeserializeStop(const transport_serialize::Stop& stop);
+    CatalogueSaveData::Stop DeserializeStop(const transport_serialize::Stop& stop);
     CatalogueSaveData::Bus DeserializeBus(const transport_serialize::Bus& bus);
     CatalogueSaveData::StopToBuses DeserializeStopToBuses(const transport_serialize::StopToBuses& stb);
     CatalogueSaveData::Distance DeserializeDistance(const transport_serialize::Distance& dist);
     CatalogueSaveData::GeoDistance DeserializeGeoDistance(const transport_serialize::GeoDistance& dist);
     CatalogueSaveData::BusToTotal DeserializeBusToTotal(const transport_serialize::BusToTotal& dist);
+    PerfectHashIndex DeserializeNameIndex(const transport_serialize::NameIndex& index);
+    StopBusIndex DeserializeStopBusIndex(const transport_serialize::StopBusIndex& index);
 
     TransportCatalogue& db_;
     renderer::MapRenderer& renderer_;
     TransportRouter& router_;
-    const io::JsonReader& reader_;
     const std::string file_;
+    const bool omit_derived_;
 };
 
 
@@ -0,0 +1,130 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "json_builder.h"
+#include "json_reader.h"
+#include "serialization.h"
+#include "synthetic_city.h"
+
+using namespace std::literals;
+
+// Compares the two snapshot modes: "full" stores every catalogue section,
+// "derived" omits stop_to_buses, geo_distances and per-bus totals and
+// rebuilds them on load.
+
+namespace {
+
+struct BenchmarkParams {
+    transport::synthetic::CityParams city;
+    size_t repeats = 5;
+};
+
+json::Node MakeSettings(const std::string& file, bool omit_derived) {
+    return json::Builder{}.StartDict()
+        .Key("file").Value(file)
+        .Key("omit_derived").Value(omit_derived)
+        .EndDict().Build();
+}
+
+std::string ToJsonText(json::Dict root) {
+    std::ostringstream out;
+    json::Print(json::Document{json::Node{std::move(root)}}, out);
+    return out.str();
+}
+
+void MakeBase(const std::string& input) {
+    transport::TransportCatalogue catalogue;
+    transport::renderer::MapRenderer renderer;
+    transport::TransportRouter router(catalogue);
+    transport::RequestHandler handler(catalogue, renderer);
+    transport::io::JsonReader reader(catalogue, handler, renderer, router);
+    std::istringstream in(input);
+    reader.ReadJsonFromStream(in);
+    reader.FillDB();
+    transport::Serializer serializer(catalogue, renderer, router, reader);
+    reader.ProcessAndApplyRouterSettings();
+    serializer.SaveData();
+}
+
+double LoadBase(const std::string& input) {
+    transport::TransportCatalogue catalogue;
+    transport::renderer::MapRenderer renderer;
+    transport::TransportRouter router(catalogue);
+    transport::RequestHandler handler(catalogue, renderer);
+    transport::io::JsonReader reader(catalogue, handler, renderer, router);
+    std::istringstream in(input);
+    reader.ReadJsonFromStream(in);
+    transport::Serializer serializer(catalogue, renderer, router, reader);
+    auto start = std::chrono::steady_clock::now();
+    serializer.LoadData();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+size_t GetCatalogueSectionSize(const std::string& file) {
+    std::ifstream in(file, std::ios::binary);
+    transport_serialize::SaveData savedata;
+    if (!savedata.ParseFromIstream(&in)) {
+        return 0;
+    }
+    return savedata.transport_catalogue().ByteSizeLong();
+}
+
+void RunMode(const BenchmarkParams& params, const json::Document& city, bool omit_derived) {
+    const std::string file = omit_derived ? "snapshot_benchmark_derived.db"s : "snapshot_benchmark_full.db"s;
+    json::Dict make_base = city.GetRoot().AsDict();
+    make_base["serialization_settings"] = MakeSettings(file, omit_derived);
+    MakeBase(ToJsonText(std::move(make_base)));
+
+    json::Dict process;
+    process["serialization_settings"] = MakeSettings(file, omit_derived);
+    const std::string process_input = ToJsonText(std::move(process));
+
+    double best = 0.0;
+    double total = 0.0;
+    for (size_t i = 0; i < params.repeats; ++i) {
+        double elapsed = LoadBase(process_input);
+        best = (i == 0) ? elapsed : std::min(best, elapsed);
+        total += elapsed;
+    }
+    std::cout << (omit_derived ? "derived"sv : "full   "sv)
+              << "  size " << std::filesystem::file_size(file) << " bytes"
+              << " (catalogue section " << GetCatalogueSectionSize(file) << ")"
+              << ", load best " << best << " ms"
+              << ", load mean " << total / params.repeats << " ms" << std::endl;
+    std::filesystem::remove(file);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchmarkParams params;
+    params.city.stop_count = 500;
+    if (argc > 1) {
+        params.city.stop_count = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        params.city.bus_count = std::stoul(argv[2]);
+    }
+    if (argc > 3) {
+        params.city.route_length = std::stoul(argv[3]);
+    }
+    if (argc > 4) {
+        params.repeats = std::max<size_t>(1, std::stoul(argv[4]));
+    }
+    if (params.city.stop_count < 2 || params.city.route_length < 2) {
+        std::cerr << "Usage: snapshot_benchmark [stops] [buses] [stops_per_bus] [repeats]" << std::endl;
+        return 1;
+    }
+    std::cout << "stops " << params.city.stop_count << ", buses " << params.city.bus_count
+              << ", stops per bus " << params.city.route_length << std::endl;
+
+    const json::Document city = transport::synthetic::GenerateMakeBase(params.city);
+    RunMode(params, city, false);
+    RunMode(params, city, true);
+}
@@ -0,0 +1,216 @@
+#include "stop_bus_index.h"
+
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSPORT_BITSET_AVX2
+#include <immintrin.h>
+#endif
+
+namespace transport {
+
+namespace {
+
+constexpr size_t WORD_BITS = 64;
+
+inline size_t PopCount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_popcountll(word));
+#else
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return static_cast<size_t>((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+inline size_t LowestBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_ctzll(word));
+#else
+    size_t bit = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+// Appends base + index of every set bit of the word
+inline void AppendBits(uint64_t word, size_t base, std::vector<size_t>& ids) {
+    while (word != 0) {
+        ids.push_back(base + LowestBit(word));
+        word &= word - 1;
+    }
+}
+
+bool IsAvx2Supported() {
+#ifdef TRANSPORT_BITSET_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+#ifdef TRANSPORT_BITSET_AVX2
+// Both return the number of words done, four per instruction; the tail is left to the scalar loop
+__attribute__((target("avx2")))
+size_t AndWordsAvx2(const uint64_t* lhs, const uint64_t* rhs, size_t count, uint64_t* out) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+        const __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_and_si256(l, r));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t OrWordsAvx2(const uint64_t* src, size_t count, uint64_t* dst) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(s, d));
+    }
+    return i;
+}
+#endif
+
+// out = lhs & rhs, returns the number of set bits of the result
+size_t AndWords(const uint64_t* lhs, const uint64_t* rhs, size_t count, uint64_t* out) {
+    size_t i = 0;
+#ifdef TRANSPORT_BITSET_AVX2
+    if (IsAvx2Supported()) {
+        i = AndWordsAvx2(lhs, rhs, count, out);
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = lhs[i] & rhs[i];
+    }
+    size_t bits = 0;
+    for (i = 0; i < count; ++i) {
+        bits += PopCount(out[i]);
+    }
+    return bits;
+}
+
+// dst |= src
+void OrWords(const uint64_t* src, size_t count, uint64_t* dst) {
+    size_t i = 0;
+#ifdef TRANSPORT_BITSET_AVX2
+    if (IsAvx2Supported()) {
+        i = OrWordsAvx2(src, count, dst);
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] |= src[i];
+    }
+}
+
+} // namespace
+
+StopBusIndex::StopBusIndex(size_t stop_count, size_t bus_count, std::vector<uint64_t> stop_buses)
+    : stop_count_(stop_count)
+    , bus_count_(bus_count)
+    , bus_words_(GetWordCount(bus_count))
+    , stop_words_(GetWordCount(stop_count))
+    , stop_buses_(std::move(stop_buses)) {
+    if (stop_buses_.size() != stop_count_ * bus_words_) {
+        throw std::invalid_argument("Stop-bus index size doesn't match stop and bus counts");
+    }
+    BuildBusStops();
+}
+
+size_t StopBusIndex::GetWordCount(size_t bit_count) {
+    return (bit_count + WORD_BITS - 1) / WORD_BITS;
+}
+
+void StopBusIndex::Build(size_t stop_count, const std::pmr::deque<Bus>& buses) {
+    stop_count_ = stop_count;
+    bus_count_ = buses.size();
+    bus_words_ = GetWordCount(bus_count_);
+    stop_words_ = GetWordCount(stop_count_);
+    stop_buses_.assign(stop_count_ * bus_words_, 0);
+    for (const Bus& bus : buses) {
+        for (const Stop* stop : bus.stops) {
+            stop_buses_[stop->id * bus_words_ + bus.id / WORD_BITS] |= uint64_t{1} << (bus.id % WORD_BITS);
+        }
+    }
+    BuildBusStops();
+}
+
+void StopBusIndex::BuildBusStops() {
+    bus_stops_.assign(bus_count_ * stop_words_, 0);
+    for (size_t stop_id = 0; stop_id < stop_count_; ++stop_id) {
+        const uint64_t* row = stop_buses_.data() + stop_id * bus_words_;
+        for (size_t w = 0; w < bus_words_; ++w) {
+            for (uint64_t word = row[w]; word != 0; word &= word - 1) {
+                const size_t bus_id = w * WORD_BITS + LowestBit(word);
+                bus_stops_[bus_id * stop_words_ + stop_id / WORD_BITS] |= uint64_t{1} << (stop_id % WORD_BITS);
+            }
+        }
+    }
+}
+
+void StopBusIndex::Clear() {
+    stop_count_ = 0;
+    bus_count_ = 0;
+    bus_words_ = 0;
+    stop_words_ = 0;
+    stop_buses_.clear();
+    bus_stops_.clear();
+}
+
+bool StopBusIndex::IsEmpty() const {
+    return stop_count_ == 0;
+}
+
+size_t StopBusIndex::GetStopCount() const {
+    return stop_count_;
+}
+
+size_t StopBusIndex::GetBusCount() const {
+    return bus_count_;
+}
+
+const std::vector<uint64_t>& StopBusIndex::GetStopBuses() const {
+    return stop_buses_;
+}
+
+std::vector<size_t> StopBusIndex::GetCommonBuses(size_t from_id, size_t to_id) const {
+    const uint64_t* from = stop_buses_.data() + from_id * bus_words_;
+    const uint64_t* to = stop_buses_.data() + to_id * bus_words_;
+    std::vector<uint64_t> common(bus_words_);
+    std::vector<size_t> bus_ids;
+    bus_ids.reserve(AndWords(from, to, bus_words_, common.data()));
+    for (size_t w = 0; w < bus_words_; ++w) {
+        AppendBits(common[w], w * WORD_BITS, bus_ids);
+    }
+    return bus_ids;
+}
+
+std::vector<size_t> StopBusIndex::GetDirectStops(size_t stop_id) const {
+    std::vector<uint64_t> reachable(stop_words_, 0);
+    const uint64_t* row = stop_buses_.data() + stop_id * bus_words_;
+    for (size_t w = 0; w < bus_words_; ++w) {
+        for (uint64_t word = row[w]; word != 0; word &= word - 1) {
+            OrWords(bus_stops_.data() + (w * WORD_BITS + LowestBit(word)) * stop_words_, stop_words_, reachable.data());
+        }
+    }
+    reachable[stop_id / WORD_BITS] &= ~(uint64_t{1} << (stop_id % WORD_BITS));
+    size_t stop_count = 0;
+    for (uint64_t word : reachable) {
+        stop_count += PopCount(word);
+    }
+    std::vector<size_t> stop_ids;
+    stop_ids.reserve(stop_count);
+    for (size_t s = 0; s < stop_words_; ++s) {
+        AppendBits(reachable[s], s * WORD_BITS, stop_ids);
+    }
+    return stop_ids;
+}
+
+} // end namespace transport
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "domain.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <vector>
+
+namespace transport {
+
+// Incidence of stops and buses as bit matrices: a row of bus bits per stop and
+// its transpose, a row of stop bits per bus. Set algebra over whole rows works
+// on 64 bits per instruction (AND for buses through two stops, OR for stops one
+// bus away), which compilers vectorize further. Only the stop rows are saved,
+// the bus rows are rebuilt from them.
+class StopBusIndex {
+public:
+    StopBusIndex() = default;
+    // stop_buses holds stop_count rows of GetWordCount(bus_count) words
+    StopBusIndex(size_t stop_count, size_t bus_count, std::vector<uint64_t> stop_buses);
+
+    void Build(size_t stop_count, const std::pmr::deque<Bus>& buses);
+    void Clear();
+
+    bool IsEmpty() const;
+    size_t GetStopCount() const;
+    size_t GetBusCount() const;
+    const std::vector<uint64_t>& GetStopBuses() const;
+
+    // Ids of the buses through both stops in ascending order
+    std::vector<size_t> GetCommonBuses(size_t from_id, size_t to_id) const;
+    // Ids of the other stops of all buses through the stop in ascending order,
+    // i.e. the stops reachable without a transfer in either direction
+    std::vector<size_t> GetDirectStops(size_t stop_id) const;
+
+    static size_t GetWordCount(size_t bit_count);
+
+private:
+    void BuildBusStops();
+
+    size_t stop_count_ = 0;
+    size_t bus_count_ = 0;
+    size_t bus_words_ = 0;  // words per stop row
+    size_t stop_words_ = 0; // words per bus row
+    std::vector<uint64_t> stop_buses_; // [stop_id * bus_words_ + bus_id / 64]
+    std::vector<uint64_t> bus_stops_;  // [bus_id * stop_words_ + stop_id / 64]
+};
+
+} // end namespace transport
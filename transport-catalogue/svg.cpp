@@ -205,7 +205,20 @@ void Text::RenderObject(const RenderContext& context) const {
     
 // ----------- Document ------------
 
-void Document::AddPtr(std::unique_ptr<Object>&& obj) {
+ObjectDeleter::ObjectDeleter(std::pmr::memory_resource* resource, void* memory, size_t size, size_t alignment)
+    : resource_(resource), memory_(memory), size_(size), alignment_(alignment) {
+}
+
+void ObjectDeleter::operator()(Object* obj) const {
+    obj->~Object();
+    resource_->deallocate(memory_, size_, alignment_);
+}
+
+ObjectContainer::ObjectContainer(std::pmr::memory_resource* resource)
+    : resource_(resource), objects_(resource) {
+}
+
+void Document::AddPtr(ObjectPtr&& obj) {
     objects_.emplace_back(std::move(obj));
 }
 
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <sstream>
 #include <memory>
+#include <memory_resource>
+#include <new>
 #include <string>
 #include <vector>
 #include <optional>
@@ -245,17 +247,38 @@ private:
     std::string data_ = "";
 };
     
+// Destroys an object placed by ObjectContainer::Add and returns its memory to the resource
+class ObjectDeleter {
+public:
+    ObjectDeleter() = default;
+    ObjectDeleter(std::pmr::memory_resource* resource, void* memory, size_t size, size_t alignment);
+
+    void operator()(Object* obj) const;
+
+private:
+    std::pmr::memory_resource* resource_ = nullptr;
+    void* memory_ = nullptr;
+    size_t size_ = 0;
+    size_t alignment_ = 0;
+};
+
+using ObjectPtr = std::unique_ptr<Object, ObjectDeleter>;
+
 class ObjectContainer {
 public:
+    // Objects are allocated from the resource, which has to outlive the container
+    explicit ObjectContainer(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
     /*
      Метод Add добавляет в svg-документ любой объект-наследник svg::Object.
     */
     template <typename Obj>
     void Add(Obj obj);
     
-    virtual void AddPtr(std::unique_ptr<Object>&& obj) = 0;
+    virtual void AddPtr(ObjectPtr&& obj) = 0;
 protected:
-    std::vector<std::unique_ptr<Object>> objects_;
+    std::pmr::memory_resource* resource_;
+    std::pmr::vector<ObjectPtr> objects_;
 };
     
 class Drawable {
@@ -266,8 +289,10 @@ public:
 
 class Document : public ObjectContainer {
 public:
+    using ObjectContainer::ObjectContainer;
+
     // Добавляет в svg-документ объект-наследник svg::Object
-    void AddPtr(std::unique_ptr<Object>&& obj) override;
+    void AddPtr(ObjectPtr&& obj) override;
 
     // Выводит в ostream svg-представление документа
     void Render(std::ostream& out) const;
@@ -275,7 +300,15 @@ public:
     
 template <typename Obj>
 void ObjectContainer::Add(Obj obj) {
-    AddPtr(std::make_unique<Obj>(std::move(obj)));
+    void* memory = resource_->allocate(sizeof(Obj), alignof(Obj));
+    Obj* ptr = nullptr;
+    try {
+        ptr = new (memory) Obj(std::move(obj));
+    } catch (...) {
+        resource_->deallocate(memory, sizeof(Obj), alignof(Obj));
+        throw;
+    }
+    AddPtr(ObjectPtr(ptr, ObjectDeleter(resource_, memory, sizeof(Obj), alignof(Obj))));
 }
 
 }  // namespace svg
\ No newline at end of file
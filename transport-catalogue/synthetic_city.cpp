@@ -0,0 +1,224 @@
+#include "synthetic_city.h"
+#include "geo.h"
+#include "json_builder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace transport {
+namespace synthetic {
+
+namespace {
+
+struct Grid {
+    explicit Grid(size_t stop_count)
+        : side(static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(stop_count)))))
+        , count(stop_count) {
+    }
+
+    std::vector<size_t> GetNeighbours(size_t index) const {
+        std::vector<size_t> result;
+        size_t x = index % side;
+        size_t y = index / side;
+        if (x > 0) {
+            result.push_back(index - 1);
+        }
+        if (x + 1 < side && index + 1 < count) {
+            result.push_back(index + 1);
+        }
+        if (y > 0) {
+            result.push_back(index - side);
+        }
+        if (index + side < count) {
+            result.push_back(index + side);
+        }
+        return result;
+    }
+
+    size_t side;
+    size_t count;
+};
+
+json::Node MakeRenderSettings() {
+    return json::Builder{}.StartDict()
+        .Key("width").Value(1200)
+        .Key("height").Value(1200)
+        .Key("padding").Value(50)
+        .Key("stop_radius").Value(3)
+        .Key("line_width").Value(8)
+        .Key("bus_label_font_size").Value(14)
+        .Key("bus_label_offset").StartArray().Value(7).Value(15).EndArray()
+        .Key("stop_label_font_size").Value(12)
+        .Key("stop_label_offset").StartArray().Value(7).Value(-3).EndArray()
+        .Key("underlayer_color").StartArray().Value(255).Value(255).Value(255).Value(0.85).EndArray()
+        .Key("underlayer_width").Value(3)
+        .Key("color_palette").StartArray().Value("green").Value("red").Value("blue").Value("orange").EndArray()
+        .EndDict().Build();
+}
+
+json::Node MakeSerializationSettings(const CityParams& params) {
+    return json::Builder{}.StartDict()
+        .Key("file").Value(params.file)
+        .EndDict().Build();
+}
+
+} // namespace
+
+std::string GetStopName(size_t index) {
+    return "Stop " + std::to_string(index);
+}
+
+std::string GetBusName(size_t index) {
+    return "Bus " + std::to_string(index);
+}
+
+json::Document GenerateMakeBase(const CityParams& params) {
+    std::mt19937 gen(params.seed);
+    std::uniform_real_distribution<double> jitter(-0.001, 0.001);
+    std::uniform_real_distribution<double> probability(0.0, 1.0);
+    std::uniform_real_distribution<double> detour(1.1, 1.5);
+
+    const Grid grid(params.stop_count);
+    std::vector<geo::Coordinates> coordinates(params.stop_count);
+    for (size_t i = 0; i < params.stop_count; ++i) {
+        coordinates[i] = {55.5 + static_cast<double>(i / grid.side) * 0.005 + jitter(gen),
+                          37.3 + static_cast<double>(i % grid.side) * 0.008 + jitter(gen)};
+    }
+
+    std::vector<std::map<size_t, int>> road_distances(params.stop_count);
+    auto add_distance = [&](size_t from, size_t to) {
+        if (road_distances[from].count(to) != 0 || road_distances[to].count(from) != 0) {
+            return;
+        }
+        double geo_distance = geo::ComputeDistance(coordinates[from], coordinates[to]);
+        road_distances[from][to] = std::max(1, static_cast<int>(geo_distance * detour(gen)));
+    };
+
+    for (size_t i = 0; i < params.stop_count; ++i) {
+        for (size_t neighbour : grid.GetNeighbours(i)) {
+            if (neighbour > i && probability(gen) < params.road_distance_density) {
+                add_distance(i, neighbour);
+                if (probability(gen) < 0.5) { // asymmetric pair
+                    double geo_distance = geo::ComputeDistance(coordinates[i], coordinates[neighbour]);
+                    road_distances[neighbour][i] = std::max(1, static_cast<int>(geo_distance * detour(gen)));
+                }
+            }
+        }
+    }
+
+    json::Array base_requests;
+    std::vector<json::Node> buses;
+    std::uniform_int_distribution<size_t> start_stop(0, params.stop_count - 1);
+    for (size_t b = 0; b < params.bus_count; ++b) {
+        std::vector<size_t> route;
+        route.push_back(start_stop(gen));
+        for (size_t i = 1; i < params.route_length; ++i) {
+            std::vector<size_t> neighbours = grid.GetNeighbours(route.back());
+            if (route.size() > 1 && neighbours.size() > 1) {
+                neighbours.erase(std::remove(neighbours.begin(), neighbours.end(), route[route.size() - 2]),
+                                 neighbours.end());
+            }
+            if (neighbours.empty()) {
+                break;
+            }
+            size_t next = neighbours[std::uniform_int_distribution<size_t>(0, neighbours.size() - 1)(gen)];
+            add_distance(route.back(), next);
+            route.push_back(next);
+        }
+        bool roundtrip = probability(gen) < params.roundtrip_ratio;
+        if (roundtrip && route.size() > 1) {
+            add_distance(route.back(), route.front());
+            route.push_back(route.front());
+        }
+        json::Array stops;
+        for (size_t stop : route) {
+            stops.emplace_back(GetStopName(stop));
+        }
+        buses.push_back(json::Builder{}.StartDict()
+            .Key("type").Value("Bus")
+            .Key("name").Value(GetBusName(b))
+            .Key("stops").Value(std::move(stops))
+            .Key("is_roundtrip").Value(roundtrip)
+            .EndDict().Build());
+    }
+
+    for (size_t i = 0; i < params.stop_count; ++i) {
+        json::Dict distances;
+        for (const auto& [to, distance] : road_distances[i]) {
+            distances[GetStopName(to)] = json::Node{distance};
+        }
+        base_requests.push_back(json::Builder{}.StartDict()
+            .Key("type").Value("Stop")
+            .Key("name").Value(GetStopName(i))
+            .Key("latitude").Value(coordinates[i].lat)
+            .Key("longitude").Value(coordinates[i].lng)
+            .Key("road_distances").Value(std::move(distances))
+            .EndDict().Build());
+    }
+    for (auto& bus : buses) {
+        base_requests.push_back(std::move(bus));
+    }
+
+    json::Dict root;
+    root["serialization_settings"] = MakeSerializationSettings(params);
+    root["routing_settings"] = json::Builder{}.StartDict()
+        .Key("bus_wait_time").Value(4)
+        .Key("bus_velocity").Value(30)
+        .EndDict().Build();
+    root["render_settings"] = MakeRenderSettings();
+    root["base_requests"] = std::move(base_requests);
+    return json::Document{json::Node{std::move(root)}};
+}
+
+json::Document GenerateProcessRequests(const CityParams& params) {
+    std::mt19937 gen(params.seed + 1);
+    std::uniform_int_distribution<int> type(0, 2);
+    std::uniform_int_distribution<size_t> stop(0, params.stop_count); // one past the end is a missing stop
+    std::uniform_int_distribution<size_t> bus(0, params.bus_count);
+
+    json::Array stat_requests;
+    for (size_t i = 0; i < params.stat_request_count; ++i) {
+        const int id = static_cast<int>(i + 1);
+        switch (type(gen)) {
+            case 0:
+                stat_requests.push_back(json::Builder{}.StartDict()
+                    .Key("id").Value(id)
+                    .Key("type").Value("Bus")
+                    .Key("name").Value(GetBusName(bus(gen)))
+                    .EndDict().Build());
+                break;
+            case 1:
+                stat_requests.push_back(json::Builder{}.StartDict()
+                    .Key("id").Value(id)
+                    .Key("type").Value("Stop")
+                    .Key("name").Value(GetStopName(stop(gen)))
+                    .EndDict().Build());
+                break;
+            default:
+                stat_requests.push_back(json::Builder{}.StartDict()
+                    .Key("id").Value(id)
+                    .Key("type").Value("Route")
+                    .Key("from").Value(GetStopName(stop(gen) % params.stop_count))
+                    .Key("to").Value(GetStopName(stop(gen) % params.stop_count))
+                    .EndDict().Build());
+                break;
+        }
+    }
+    if (params.with_map_request) {
+        stat_requests.push_back(json::Builder{}.StartDict()
+            .Key("id").Value(static_cast<int>(params.stat_request_count + 1))
+            .Key("type").Value("Map")
+            .EndDict().Build());
+    }
+
+    json::Dict root;
+    root["serialization_settings"] = MakeSerializationSettings(params);
+    root["stat_requests"] = std::move(stat_requests);
+    return json::Document{json::Node{std::move(root)}};
+}
+
+} // end namespace synthetic
+} // end namespace transport
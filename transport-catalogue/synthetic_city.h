@@ -0,0 +1,35 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstdint>
+#include <string>
+
+namespace transport {
+namespace synthetic {
+
+// Parameters of a generated network. Stops lie on a jittered square grid
+// and every bus is a random walk between neighbouring grid cells.
+struct CityParams {
+    size_t stop_count = 1000;
+    size_t bus_count = 100;
+    size_t route_length = 20;           // stops per bus as given in the input
+    double roundtrip_ratio = 0.5;       // share of roundtrip buses
+    double road_distance_density = 0.3; // chance that a neighbouring grid pair gets an extra road distance
+    size_t stat_request_count = 1000;
+    bool with_map_request = true;
+    uint32_t seed = 42;
+    std::string file = "transport_catalogue.db";
+};
+
+std::string GetStopName(size_t index);
+std::string GetBusName(size_t index);
+
+// Whole make_base input: serialization, routing and render settings plus base_requests
+json::Document GenerateMakeBase(const CityParams& params);
+
+// process_requests input with a uniform mix of Bus, Stop and Route requests
+json::Document GenerateProcessRequests(const CityParams& params);
+
+} // end namespace synthetic
+} // end namespace transport
@@ -1,15 +1,68 @@
 #include "transport_catalogue.h"
+#include "parallel.h"
 
+#include <algorithm>
+#include <tuple>
 #include <unordered_set>
 
 #include <iostream>
 
 namespace transport {
 
+namespace {
+
+template <typename Map>
+PerfectHashIndex BuildIndex(const Map& name_to_item) {
+    std::vector<std::pair<std::string_view, uint32_t>> names;
+    names.reserve(name_to_item.size());
+    for (const auto& [name, item] : name_to_item) {
+        names.push_back({name, static_cast<uint32_t>(item->id)});
+    }
+    PerfectHashIndex index;
+    index.Build(names);
+    return index;
+}
+
+// Every name has to come back with its own id, a stale or foreign index may have the right size
+template <typename Map>
+bool IsIndexValid(const PerfectHashIndex& index, const Map& name_to_item) {
+    if (index.GetSize() != name_to_item.size()) {
+        return false;
+    }
+    if (!name_to_item.empty() && index.GetSeeds().empty()) {
+        return false;
+    }
+    for (const auto& [name, item] : name_to_item) {
+        if (index.Find(name) != item->id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+TransportCatalogue::TransportCatalogue(std::pmr::memory_resource* resource)
+    : resource_(resource)
+    , stops_(resource)
+    , buses_(resource)
+    , stopname_to_stop_(resource)
+    , stop_id_to_stop_(resource)
+    , busname_to_bus_(resource)
+    , bus_id_to_bus_(resource)
+    , stop_to_buses_(resource)
+    , distances_(resource)
+    , geo_distances_(resource)
+    , busname_to_total_distances_(resource) {
+}
+
 void TransportCatalogue::AddStop(std::string_view stopname, geo::Coordinates coordinates) {
     size_t id = stops_.size();
-    stops_.push_back({id, static_cast<std::string>(stopname), coordinates});
-    std::string_view name = stops_.back().name;
+    std::string_view name = names_.Intern(stopname);
+    stops_.push_back({id, name, coordinates});
+    stop_points_.Add(coordinates);
+    stop_index_.Clear();
+    stop_bus_index_.Clear();
     stopname_to_stop_[name] = &stops_.back();
     if (stop_to_buses_.count(name) == 0) {
         stop_to_buses_[name] = {};
@@ -19,39 +72,28 @@ void TransportCatalogue::AddStop(std::string_view stopname, geo::Coordinates coo
 
 void TransportCatalogue::AddBus(std::string_view busname, std::vector<std::string_view>& stops, bool looped) {
     size_t id = buses_.size();
-    buses_.push_back({id, static_cast<std::string>(busname), {}, looped});
-    std::string_view name = buses_.back().name;
+    std::string_view name = names_.Intern(busname);
+    buses_.push_back({id, name, std::pmr::vector<const Stop*>(resource_), looped});
+    bus_index_.Clear();
+    stop_bus_index_.Clear();
     busname_to_bus_[name] = &buses_.back();
     std::vector<const Stop*> stop_ptrs;
     for(const auto& sv: stops) {
         stop_ptrs.push_back(FindStop(sv));
         stop_to_buses_[sv].insert(name);
     }
-    buses_.back().stops = stop_ptrs;
+    buses_.back().stops.assign(stop_ptrs.begin(), stop_ptrs.end());
     bus_id_to_bus_[id] = &buses_.back();
-    
-    int total_distance = 0;
-    double total_geo_distance = 0.0;
-    for(size_t i = 1; i < stop_ptrs.size(); ++i) {
-        double distance = ComputeDistance(stop_ptrs[i-1]->coordinates, stop_ptrs[i]->coordinates);
-        std::pair<const Stop*, const Stop*> pair;
-        pair.first = stop_ptrs[i-1];
-        pair.second = stop_ptrs[i];
-        geo_distances_[pair] = distance;
-        total_distance += GetDistance(stop_ptrs[i-1], stop_ptrs[i]);
-        total_geo_distance += distance;
-    }
-    busname_to_total_distances_[name] = {total_distance, total_geo_distance};
 }
     
 void TransportCatalogue::SetDistance(const Stop* from, const Stop* to, int distance) {
-    if (distances_.count({from, to}) == 0) {
-        distances_[{from, to}] = distance;
-        distances_[{to, from}] = distance;
-    } else {
-        distances_.at({from, to}) = distance;
+    // only the given direction is stored, GetDistance falls back to the reverse one.
+    // A reverse that wasn't set keeps the first value when the direction is set again.
+    auto forward = distances_.find({from, to});
+    if (forward != distances_.end() && distances_.count({to, from}) == 0) {
+        distances_[{to, from}] = forward->second;
     }
-    
+    distances_[{from, to}] = distance;
 }
 
 int TransportCatalogue::GetDistance(const Stop* from, const Stop* to) const {
@@ -71,11 +113,12 @@ double TransportCatalogue::GetGeoDistance(const Stop* from, const Stop* to) cons
 }
 
 const Stop* TransportCatalogue::FindStop(std::string_view name) const {
-    if (stopname_to_stop_.count(name) != 0) {
-        return stopname_to_stop_.at(name);
-    } else {
-        return nullptr;
+    if (!stop_index_.IsEmpty()) {
+        size_t id = stop_index_.Find(name);
+        return stops_[id].name == name ? &stops_[id] : nullptr;
     }
+    auto it = stopname_to_stop_.find(name);
+    return it != stopname_to_stop_.end() ? it->second : nullptr;
 }
     
 const Stop* TransportCatalogue::GetStopById(size_t id) const {
@@ -87,11 +130,12 @@ const Stop* TransportCatalogue::GetStopById(size_t id) const {
 }
 
 const Bus* TransportCatalogue::FindBus(std::string_view name) const {
-    if (busname_to_bus_.count(name) != 0) {
-        return busname_to_bus_.at(name);
-    } else {
-        return nullptr;
+    if (!bus_index_.IsEmpty()) {
+        size_t id = bus_index_.Find(name);
+        return buses_[id].name == name ? &buses_[id] : nullptr;
     }
+    auto it = busname_to_bus_.find(name);
+    return it != busname_to_bus_.end() ? it->second : nullptr;
 }
 
 const Bus* TransportCatalogue::GetBusById(size_t id) const {
@@ -109,7 +153,7 @@ const BusInfo TransportCatalogue::GetBusInfo(std::string_view name) const {
         info.name = name;
         std::unordered_set<const Stop*> unique_stops(bus_ptr->stops.begin(), bus_ptr->stops.end());
         info.uniqueStopsCount = unique_stops.size();
-        info.totalStopsCount = bus_ptr->stops.size();
+        info.totalStopsCount = bus_ptr->GetRoute().size();
         int total_distance = busname_to_total_distances_.at(name).first;
         double total_geo_distance = busname_to_total_distances_.at(name).second;
         info.routeLength = total_distance;
@@ -118,27 +162,45 @@ const BusInfo TransportCatalogue::GetBusInfo(std::string_view name) const {
     return info;
 }
     
-const std::unordered_map<std::string_view, std::unordered_set<std::string_view>>& TransportCatalogue::GetStopToBuses() const {
+const TransportCatalogue::Distances& TransportCatalogue::GetDistances() const {
+    return distances_;
+}
+
+bool TransportCatalogue::HasMirroredDistances() const {
+    return mirrored_distances_;
+}
+
+const TransportCatalogue::StopToBuses& TransportCatalogue::GetStopToBuses() const {
     return stop_to_buses_;
 }
     
-const std::deque<Stop>& TransportCatalogue::GetStops() const {
+const std::pmr::deque<Stop>& TransportCatalogue::GetStops() const {
     return stops_;
 }
     
-const std::deque<Bus>& TransportCatalogue::GetBuses() const {
+const std::pmr::deque<Bus>& TransportCatalogue::GetBuses() const {
     return buses_;
 }
 
+const geo::TrigPoints& TransportCatalogue::GetStopPoints() const {
+    return stop_points_;
+}
+
 void TransportCatalogue::LoadData(const CatalogueSaveData& data) {
     // load data from struct
-    stops_ = std::move(data.stops);
+    names_.Load(data.name_pool);
+    stop_points_.Reserve(data.stops.size());
+    for (const CatalogueSaveData::Stop& s : data.stops) {
+        stops_.push_back({s.id, names_.Get(s.name), s.coordinates});
+        stop_points_.Add(s.coordinates);
+    }
     for (const Stop& s : stops_) {
         stopname_to_stop_[s.name] = &s;
         stop_id_to_stop_[s.id] = &s;
     }
     for (const CatalogueSaveData::Bus& b : data.buses) {
-        buses_.push_back({b.id, b.name, {}, b.is_roundtrip});
+        buses_.push_back({b.id, names_.Get(b.name), std::pmr::vector<const Stop*>(resource_), b.is_roundtrip});
+        buses_.back().stops.reserve(b.stop_ids.size());
         for(size_t id: b.stop_ids) {
             buses_.back().stops.push_back(GetStopById(id));
         }
@@ -156,6 +218,7 @@ void TransportCatalogue::LoadData(const CatalogueSaveData& data) {
         std::pair<const Stop*, const Stop*> p{GetStopById(d.from), GetStopById(d.to)};
         distances_[p] = d.distance;
     }
+    mirrored_distances_ = !data.one_way_distances && !data.distances.empty();
     for (const CatalogueSaveData::GeoDistance& d : data.geo_distances) {
         std::pair<const Stop*, const Stop*> p{GetStopById(d.from), GetStopById(d.to)};
         geo_distances_[p] = d.distance;
@@ -163,46 +226,148 @@ void TransportCatalogue::LoadData(const CatalogueSaveData& data) {
     for (const CatalogueSaveData::BusToTotal& d : data.bus_id_to_total_distances) {
         busname_to_total_distances_[GetBusById(d.id)->name] = {d.distance, d.geo_distance};
     }
+    stop_index_ = data.stop_index;
+    bus_index_ = data.bus_index;
+    if (!IsIndexValid(stop_index_, stopname_to_stop_) || !IsIndexValid(bus_index_, busname_to_bus_)) {
+        BuildNameIndex();
+    }
+    stop_bus_index_ = data.stop_bus_index;
+    if (stop_bus_index_.GetStopCount() != stops_.size() || stop_bus_index_.GetBusCount() != buses_.size()) {
+        // older file without the index
+        BuildStopBusIndex();
+    }
+    if (data.derived_omitted) {
+        RebuildDerivedData();
+    }
+}
+
+void TransportCatalogue::BuildNameIndex() {
+    stop_index_ = BuildIndex(stopname_to_stop_);
+    bus_index_ = BuildIndex(busname_to_bus_);
+}
+
+void TransportCatalogue::BuildStopBusIndex() {
+    stop_bus_index_.Build(stops_.size(), buses_);
+}
+
+const StopBusIndex& TransportCatalogue::GetStopBusIndex() const {
+    return stop_bus_index_;
+}
+
+void TransportCatalogue::RebuildDerivedData() {
+    struct BusDerived {
+        std::vector<std::pair<std::pair<const Stop*, const Stop*>, double>> geo_distances;
+        int total_distance = 0;
+        double total_geo_distance = 0.0;
+    };
+    // buses_ is a deque, so workers index through a flat pointer array
+    std::vector<const Bus*> buses;
+    buses.reserve(buses_.size());
+    for (const Bus& bus : buses_) {
+        buses.push_back(&bus);
+    }
+    std::vector<BusDerived> derived(buses.size());
+    parallel::ForEachChunk(buses.size(), parallel::GetThreadCount(buses.size(), 16),
+                           [&](size_t begin, size_t end, size_t) {
+        for (size_t b = begin; b < end; ++b) {
+            const RouteView stops = buses[b]->GetRoute();
+            BusDerived& result = derived[b];
+            result.geo_distances.reserve(stops.size());
+            for (size_t i = 1; i < stops.size(); ++i) {
+                double distance = stop_points_.ComputeDistance(stops[i-1]->id, stops[i]->id);
+                result.geo_distances.push_back({{stops[i-1], stops[i]}, distance});
+                result.total_distance += GetDistance(stops[i-1], stops[i]);
+                result.total_geo_distance += distance;
+            }
+        }
+    });
+
+    geo_distances_.clear();
+    busname_to_total_distances_.clear();
+    stop_to_buses_.clear();
+    for (const Stop& stop : stops_) {
+        stop_to_buses_[stop.name] = {};
+    }
+    for (size_t b = 0; b < buses.size(); ++b) {
+        std::string_view name = buses[b]->name;
+        for (const Stop* stop : buses[b]->stops) {
+            stop_to_buses_[stop->name].insert(name);
+        }
+        for (const auto& [pair, distance] : derived[b].geo_distances) {
+            geo_distances_[pair] = distance;
+        }
+        busname_to_total_distances_[name] = {derived[b].total_distance, derived[b].total_geo_distance};
+    }
 }
 
-CatalogueSaveData TransportCatalogue::SaveData() const {
+CatalogueSaveData TransportCatalogue::SaveData(bool omit_derived) const {
     CatalogueSaveData r;
-    r.stops = {}; // serializer gets this straight from db_
+    r.name_pool = names_.Save();
+    r.derived_omitted = omit_derived;
+    r.one_way_distances = !mirrored_distances_;
+    r.stop_index = stop_index_.IsEmpty() ? BuildIndex(stopname_to_stop_) : stop_index_;
+    r.bus_index = bus_index_.IsEmpty() ? BuildIndex(busname_to_bus_) : bus_index_;
+    if (stop_bus_index_.IsEmpty() && !stops_.empty()) {
+        r.stop_bus_index.Build(stops_.size(), buses_);
+    } else {
+        r.stop_bus_index = stop_bus_index_;
+    }
+
+    r.stops.reserve(stops_.size());
+    for (const Stop& stop : stops_) {
+        r.stops.push_back({stop.id, names_.GetRef(stop.name), stop.coordinates});
+    }
 
     for (const Bus& bus: buses_) {
         std::vector<size_t> ids;
         for (const Stop* s: bus.stops) {
             ids.push_back(s->id);
         }
-        CatalogueSaveData::Bus b{bus.id, bus.name, ids, bus.is_roundtrip};
+        CatalogueSaveData::Bus b{bus.id, names_.GetRef(bus.name), ids, bus.is_roundtrip};
         r.buses.push_back(std::move(b));
     }
+    // hash maps are written in id order, so the file doesn't depend on the order
+    // the data was added in and an updated base is the same as a rebuilt one
+    auto by_ids = [](const auto& lhs, const auto& rhs) {
+        return std::tie(lhs.from, lhs.to) < std::tie(rhs.from, rhs.to);
+    };
+    auto by_id = [](const auto& lhs, const auto& rhs) {
+        return lhs.id < rhs.id;
+    };
+    for (const auto& [stop_pair, dist]: distances_) {
+        size_t from = stop_pair.first->id;
+        size_t to = stop_pair.second->id;
+        CatalogueSaveData::Distance d{from, to, dist};
+        r.distances.push_back(std::move(d));
+    }
+    std::sort(r.distances.begin(), r.distances.end(), by_ids);
+    if (omit_derived) {
+        return r;
+    }
     for (const auto& [name, bus_names]: stop_to_buses_) {
         size_t id = FindStop(name)->id;
         std::vector<size_t> bus_ids;
         for (const auto& n : bus_names) {
             bus_ids.push_back(FindBus(n)->id);
         }
+        std::sort(bus_ids.begin(), bus_ids.end());
         CatalogueSaveData::StopToBuses s{id, bus_ids};
         r.stop_to_buses.push_back(std::move(s));
     }
-    for (const auto& [stop_pair, dist]: distances_) {
-        size_t from = stop_pair.first->id;
-        size_t to = stop_pair.second->id;
-        CatalogueSaveData::Distance d{from, to, dist};
-        r.distances.push_back(std::move(d));
-    }
+    std::sort(r.stop_to_buses.begin(), r.stop_to_buses.end(), by_id);
     for (const auto& [stop_pair, dist]: geo_distances_) {
         size_t from = stop_pair.first->id;
         size_t to = stop_pair.second->id;
         CatalogueSaveData::GeoDistance d{from, to, dist};
         r.geo_distances.push_back(std::move(d));
     }
+    std::sort(r.geo_distances.begin(), r.geo_distances.end(), by_ids);
     for (const auto& [name, pair_dist]: busname_to_total_distances_) {
         size_t id = FindBus(name)->id;
         CatalogueSaveData::BusToTotal d{id, pair_dist.first, pair_dist.second};
         r.bus_id_to_total_distances.push_back(std::move(d));
     }
+    std::sort(r.bus_id_to_total_distances.begin(), r.bus_id_to_total_distances.end(), by_id);
 
     return r;
 }
@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <deque>
+#include <memory_resource>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -10,14 +11,22 @@
 
 #include "geo.h"
 #include "domain.h"
+#include "name_pool.h"
+#include "perfect_hash.h"
+#include "stop_bus_index.h"
 
 namespace transport {
 
 struct CatalogueSaveData {
+    struct Stop {
+        size_t id;
+        NameRef name;
+        geo::Coordinates coordinates;
+    };
     struct Bus {
         size_t id;
-        std::string name;
-        std::vector<size_t> stop_ids;
+        NameRef name;
+        std::vector<size_t> stop_ids; // the way there only unless is_roundtrip
         bool is_roundtrip;
     };
     struct StopToBuses {
@@ -39,33 +48,61 @@ struct CatalogueSaveData {
         int distance;
         double geo_distance;
     };
-    std::deque<Stop> stops;
-    std::deque<Bus> buses;
+    std::string name_pool;
+    std::vector<Stop> stops;
+    std::vector<Bus> buses;
     std::vector<StopToBuses> stop_to_buses;
     std::vector<Distance> distances;
     std::vector<GeoDistance> geo_distances;
     std::vector<BusToTotal> bus_id_to_total_distances;
+    bool derived_omitted = false; // stop_to_buses, geo_distances and totals are left empty
+    bool one_way_distances = true; // false in older files, where every reverse was stored as well
+    PerfectHashIndex stop_index;
+    PerfectHashIndex bus_index;
+    StopBusIndex stop_bus_index;
 };
 
 class TransportCatalogue {
 public:
+    using StopToBuses = std::pmr::unordered_map<std::string_view, std::pmr::unordered_set<std::string_view>>;
+    using Distances = std::pmr::unordered_map<std::pair<const Stop*, const Stop*>, int, StopHasher>;
 
-    TransportCatalogue() {}
+    // Stops, buses, their stop lists and the lookup tables are allocated from the
+    // resource, which has to outlive the catalogue. It isn't shared between
+    // threads: a monotonic arena is fine as long as the catalogue is filled by one.
+    explicit TransportCatalogue(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
     void AddStop(std::string_view name, geo::Coordinates coordinates);
+    // Stops of a non-roundtrip bus are the way there only, see Bus::GetRoute().
+    // Geo distances and route lengths of added buses are computed by RebuildDerivedData()
     void AddBus(std::string_view name, std::vector<std::string_view>& stops, bool looped = false);
     void SetDistance(const Stop* from, const Stop* to, int distance);
     int GetDistance(const Stop* from, const Stop* to) const;
+    // Road distances in the directions they were set
+    const Distances& GetDistances() const;
+    // Loaded from an older base, where a reverse copied on the first SetDistance
+    // can't be told from one set explicitly
+    bool HasMirroredDistances() const;
     double GetGeoDistance(const Stop* from, const Stop* to) const;
     const Stop* FindStop(std::string_view name) const;
     const Stop* GetStopById(size_t id) const;
     const Bus* FindBus(std::string_view name) const;
     const Bus* GetBusById(size_t id) const;
     const BusInfo GetBusInfo(std::string_view name) const;
-    const std::unordered_map<std::string_view, std::unordered_set<std::string_view>>& GetStopToBuses() const;
-    const std::deque<Stop>& GetStops() const;
-    const std::deque<Bus>& GetBuses() const;
+    const StopToBuses& GetStopToBuses() const;
+    const std::pmr::deque<Stop>& GetStops() const;
+    const std::pmr::deque<Bus>& GetBuses() const;
+    // Coordinates of stops indexed by stop id, with trigonometry precomputed
+    const geo::TrigPoints& GetStopPoints() const;
     void LoadData(const CatalogueSaveData& data);
-    CatalogueSaveData SaveData() const;
+    CatalogueSaveData SaveData(bool omit_derived = false) const;
+    // stop_to_buses, geo distances and route lengths of all buses, in parallel
+    void RebuildDerivedData();
+    // Builds perfect hash indices over current names for FindStop and FindBus.
+    // Adding a stop or a bus drops the corresponding index.
+    void BuildNameIndex();
+    // Builds the stop x bus bit matrix; adding a stop or a bus drops it
+    void BuildStopBusIndex();
+    const StopBusIndex& GetStopBusIndex() const;
     
     void Print() const {
         std::cout << "Stops:" << std::endl;
@@ -76,16 +113,23 @@ public:
 
 private:
 
-    std::deque<Stop> stops_;
-    std::deque<Bus> buses_;
-    std::unordered_map<std::string_view, const Stop*> stopname_to_stop_;
-    std::unordered_map<size_t, const Stop*> stop_id_to_stop_;
-    std::unordered_map<std::string_view, const Bus*> busname_to_bus_;
-    std::unordered_map<size_t, const Bus*> bus_id_to_bus_;
-    std::unordered_map<std::string_view, std::unordered_set<std::string_view>> stop_to_buses_;
-    std::unordered_map<std::pair<const Stop*, const Stop*>, int, StopHasher> distances_;
-    std::unordered_map<std::pair<const Stop*, const Stop*>, double, StopHasher> geo_distances_;
-    std::unordered_map<std::string_view, std::pair<int, double>> busname_to_total_distances_;
+    std::pmr::memory_resource* resource_;
+    NamePool names_;
+    std::pmr::deque<Stop> stops_;
+    geo::TrigPoints stop_points_;
+    std::pmr::deque<Bus> buses_;
+    PerfectHashIndex stop_index_;
+    PerfectHashIndex bus_index_;
+    StopBusIndex stop_bus_index_;
+    std::pmr::unordered_map<std::string_view, const Stop*> stopname_to_stop_;
+    std::pmr::unordered_map<size_t, const Stop*> stop_id_to_stop_;
+    std::pmr::unordered_map<std::string_view, const Bus*> busname_to_bus_;
+    std::pmr::unordered_map<size_t, const Bus*> bus_id_to_bus_;
+    StopToBuses stop_to_buses_;
+    Distances distances_;
+    bool mirrored_distances_ = false;
+    std::pmr::unordered_map<std::pair<const Stop*, const Stop*>, double, StopHasher> geo_distances_;
+    std::pmr::unordered_map<std::string_view, std::pair<int, double>> busname_to_total_distances_;
 
 };
 
@@ -1,16 +1,62 @@
 #include "transport_router.h"
+#include "dijkstra.h"
+#include "parallel.h"
+#include "profiler.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
 
 namespace transport {
+
+namespace {
+
+constexpr uint32_t HILBERT_ORDER = 16;
+
+// Position of the cell on a Hilbert curve filling a 2^16 x 2^16 grid
+uint64_t GetHilbertIndex(uint32_t x, uint32_t y) {
+    constexpr uint32_t side = uint32_t{1} << HILBERT_ORDER;
+    uint64_t index = 0;
+    for (uint32_t s = side / 2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) > 0 ? 1 : 0;
+        uint32_t ry = (y & s) > 0 ? 1 : 0;
+        index += uint64_t{s} * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = side - 1 - x;
+                y = side - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return index;
+}
+
+} // namespace
     
 TransportRouter::TransportRouter(const TransportCatalogue& db)
     : db_(db) {
 }
 
-void TransportRouter::SetPointers(std::unique_ptr<graph::DirectedWeightedGraph<double>> g_ptr, std::unique_ptr<graph::Router<double>> r_ptr) {
+void TransportRouter::SetPointers(std::unique_ptr<graph::DirectedWeightedGraph<double>> g_ptr, std::unique_ptr<graph::Router<double>> r_ptr,
+                                  std::vector<size_t> components, std::vector<graph::VertexId> stop_vertices) {
     graph_ = std::move(g_ptr);
     router_ = std::move(r_ptr);
+    if (stop_vertices.size() != graph_->GetVertexCount()) {
+        stop_vertices.resize(graph_->GetVertexCount());
+        std::iota(stop_vertices.begin(), stop_vertices.end(), 0);
+    }
+    SetVertexOrder(std::move(stop_vertices));
+    if (components.size() == graph_->GetVertexCount()) {
+        components_ = std::move(components);
+    } else {
+        components_ = graph::ComputeWeakComponents(*graph_);
+    }
+    BuildRaptor();
 }
     
 void TransportRouter::ApplySettings(const RouterSettings& s) {
@@ -26,65 +72,431 @@ double TransportRouter::GetBusVelocity() const {
     return bus_velocity_;
 }
     
+RouterSettings TransportRouter::GetSettings() const {
+    return {bus_wait_time_, bus_velocity_};
+}
+    
 const graph::Edge<double>& TransportRouter::GetEdge(size_t id) const {
     return graph_->GetEdge(id);
 }
 
+double TransportRouter::GetEdgeWeight(const graph::Edge<double>& edge, const RouterSettings& settings) const {
+    return IsOwnSettings(settings) ? edge.weight : ComputeEdgeWeight(settings, edge.distance);
+}
+
+double TransportRouter::ComputeEdgeWeight(const RouterSettings& settings, double distance) {
+    return settings.bus_wait_time + distance * 0.06 / settings.bus_velocity;
+}
+
 void TransportRouter::Init() {
-    if (router_ == nullptr) { // if called for the first time, create graph and router
+    if (backend_ == RoutingBackend::RAPTOR) {
+        // lines are scanned as they are, the graph is built on demand by GetInitializedGraph()
+        if (raptor_.IsEmpty()) {
+            profile::ScopedPhase phase("router_precompute");
+            BuildRaptor();
+        }
+        previous_ = nullptr;
+        return;
+    }
+    if (router_ == nullptr && landmarks_.IsEmpty() && hub_labels_.IsEmpty()) { // if called for the first time, create graph and router
+        InitGraph();
+        profile::ScopedPhase phase("router_precompute");
+        switch (backend_) {
+            case RoutingBackend::TABLE:
+                if (previous_ != nullptr && previous_->router_ != nullptr) {
+                    router_ = std::make_unique<graph::Router<double>>(*graph_, vertex_stops_, *previous_->router_);
+                    const size_t reused = router_->GetReusedComponentCount();
+                    const size_t recomputed = router_->GetRecomputedComponentCount();
+                    profile::GetProfiler().AddCounter("route_table_components_reused", static_cast<int64_t>(reused));
+                    profile::GetProfiler().AddCounter("route_table_components_recomputed", static_cast<int64_t>(recomputed));
+                    if (reused == 0 && recomputed != 0) {
+                        std::cerr << "No route table component is unchanged, the whole table of "
+                                  << recomputed << " component(s) is recomputed" << std::endl;
+                    }
+                } else {
+                    router_ = std::make_unique<graph::Router<double>>(*graph_, vertex_stops_);
+                }
+                break;
+            case RoutingBackend::ALT:
+                landmarks_ = graph::Landmarks<double>(*graph_, components_, landmark_count_);
+                break;
+            case RoutingBackend::HUB_LABELS:
+                hub_labels_ = graph::HubLabels<double>(*graph_);
+                profile::GetProfiler().AddCounter("hub_label_entries", static_cast<int64_t>(hub_labels_.GetEntryCount()));
+                break;
+            case RoutingBackend::RAPTOR: // handled above
+                break;
+        }
+        previous_ = nullptr;
+    }
+}
+
+void TransportRouter::InitGraph() {
+    if (graph_ == nullptr) {
+        profile::ScopedPhase phase("build_graph");
         graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(db_.GetStops().size());
+        ComputeVertexOrder();
         BuildGraph();
-        router_ = std::make_unique<graph::Router<double>>(*graph_);
+        if (raptor_.IsEmpty()) {
+            BuildRaptor();
+        }
+        graph_->Finalize();
+        if (edge_pruning_) {
+            PruneGraph();
+        }
+        components_ = graph::ComputeWeakComponents(*graph_);
     }
 }
 
-void TransportRouter::BuildGraph() {
-    const auto& buses = db_.GetBuses();
-    for (const auto& bus: buses) {
-        size_t size = bus.stops.size();
-        if (size == 0) {
-            continue;
+void TransportRouter::SetEdgePruning(bool enabled) {
+    edge_pruning_ = enabled;
+}
+
+void TransportRouter::SetBackend(RoutingBackend backend, size_t landmark_count) {
+    backend_ = backend;
+    landmark_count_ = landmark_count;
+}
+
+RoutingBackend TransportRouter::GetBackend() const {
+    return backend_;
+}
+
+size_t TransportRouter::GetLandmarkCount() const {
+    return landmark_count_;
+}
+
+void TransportRouter::SetPrevious(const TransportRouter* previous) {
+    previous_ = previous;
+}
+
+void TransportRouter::SetLandmarks(graph::Landmarks<double> landmarks) {
+    landmarks_ = std::move(landmarks);
+}
+
+const graph::Landmarks<double>& TransportRouter::GetLandmarks() const {
+    return landmarks_;
+}
+
+void TransportRouter::SetHubLabels(graph::HubLabels<double> hub_labels) {
+    hub_labels_ = std::move(hub_labels);
+}
+
+const graph::HubLabels<double>& TransportRouter::GetHubLabels() const {
+    return hub_labels_;
+}
+
+void TransportRouter::PruneGraph() {
+    profile::ScopedPhase phase("prune_graph");
+    const size_t edge_count = graph_->GetEdgeCount();
+    const size_t removed = graph_->RemoveDominatedEdges(parallel::GetThreadCount(graph_->GetVertexCount()));
+    profile::GetProfiler().AddCounter("graph_edges_built", static_cast<int64_t>(edge_count));
+    profile::GetProfiler().AddCounter("graph_edges_pruned", static_cast<int64_t>(removed));
+}
+
+void TransportRouter::BuildRaptor() {
+    raptor_ = Raptor(db_, [this](const Stop* from, const Stop* to) {
+        return GetSegmentDistance(from, to);
+    });
+}
+
+double TransportRouter::GetSegmentDistance(const Stop* from, const Stop* to) const {
+    try {
+        return db_.GetDistance(from, to);
+    } catch (...) {
+        try {
+            return db_.GetGeoDistance(from, to);
+        } catch (...) {
+            std::cerr << "Distance from " << from->name << " to " << to->name << " not found" << std::endl;
+            throw;
         }
+    }
+}
 
-        auto build_part = [&](size_t start, size_t finish) {
-            for(size_t i = start; i < finish; ++i) {
-                double dist = 0;
-                for(size_t j = i + 1; j < finish; ++j) {
-                    double delta = 0;
-                    try {
-                        delta = db_.GetDistance(bus.stops[j-1], bus.stops[j]);
-                    } catch (...) {
-                        try {
-                            delta = db_.GetGeoDistance(bus.stops[j-1], bus.stops[j]);
-                        } catch (...) {
-                            std::cerr << "Distance from " << bus.stops[j-1]->name
-                                << " to " << bus.stops[j]->name << " not found" << std::endl;
-                            throw;
-                        }
+bool TransportRouter::HasRouter() const {
+    return router_ != nullptr;
+}
+
+bool TransportRouter::HasGraph() const {
+    return graph_ != nullptr;
+}
+
+void TransportRouter::BuildGraph() {
+    // buses_ is a deque, so workers index through a flat pointer array
+    std::vector<const Bus*> buses;
+    buses.reserve(db_.GetBuses().size());
+    for (const Bus& bus : db_.GetBuses()) {
+        buses.push_back(&bus);
+    }
+    // edges of every bus are built on the workers and added in bus order,
+    // so edge ids are the same as with one thread
+    std::vector<std::vector<graph::Edge<double>>> bus_edges(buses.size());
+    const RouterSettings settings = GetSettings();
+    parallel::ForEachChunk(buses.size(), parallel::GetThreadCount(buses.size(), 16),
+                           [&](size_t begin, size_t end, size_t) {
+        for (size_t b = begin; b < end; ++b) {
+            const Bus& bus = *buses[b];
+            const RouteView route = bus.GetRoute();
+            const size_t size = route.size();
+            if (size == 0) {
+                continue;
+            }
+            if (size - 1 > std::numeric_limits<uint16_t>::max()) {
+                throw std::length_error("Bus " + std::string(bus.name) + " has too many stops");
+            }
+            std::vector<graph::Edge<double>>& edges = bus_edges[b];
+            auto build_part = [&](size_t start, size_t finish) {
+                for(size_t i = start; i < finish; ++i) {
+                    double dist = 0;
+                    for(size_t j = i + 1; j < finish; ++j) {
+                        dist += GetSegmentDistance(route[j-1], route[j]);
+                        double weight = ComputeEdgeWeight(settings, dist);
+                        edges.push_back({static_cast<uint32_t>(stop_vertices_[route[i]->id]),
+                                         static_cast<uint32_t>(stop_vertices_[route[j]->id]),
+                                         weight, static_cast<uint32_t>(bus.id), static_cast<uint16_t>(j - i), dist});
                     }
-                    dist += delta;
-                    double weight = bus_wait_time_ + dist * 0.06 / bus_velocity_;
-                    graph_->AddEdge({bus.stops[i]->id, bus.stops[j]->id, weight, bus.id, j-i});
                 }
+            };
+            if (bus.is_roundtrip == false) {
+                build_part(0, (size + 1) / 2); // last is not included so +1
+                build_part((size - 1) / 2, size); // start from middle
+            } else {
+                build_part(0, size);
             }
-        };
-        if (bus.is_roundtrip == false) {
-            build_part(0, (size + 1) / 2); // last is not included so +1
-            build_part((size - 1) / 2, size); // start from middle
-        } else {
-            build_part(0, size);
         }
+    });
+    for (std::vector<graph::Edge<double>>& edges : bus_edges) {
+        for (const graph::Edge<double>& edge : edges) {
+            graph_->AddEdge(edge);
+        }
+        std::vector<graph::Edge<double>>().swap(edges);
     }
 }
     
-std::optional<graph::Router<double>::RouteInfo> TransportRouter::BuildRoute(std::string_view from, std::string_view to) {
-    Init();
+std::optional<graph::Router<double>::RouteInfo> TransportRouter::BuildRoute(std::string_view from, std::string_view to) const {
     const Stop* from_ptr = db_.FindStop(from);
     const Stop* to_ptr = db_.FindStop(to);
     if (from_ptr == nullptr || to_ptr == nullptr) {
         return std::nullopt;
     }
-    return router_->BuildRoute(from_ptr->id, to_ptr->id);
+    if (router_ == nullptr) {
+        throw std::logic_error("Router is not initialized");
+    }
+    const graph::VertexId from_vertex = stop_vertices_[from_ptr->id];
+    const graph::VertexId to_vertex = stop_vertices_[to_ptr->id];
+    if (!AreInSameComponent(from_vertex, to_vertex)) {
+        return std::nullopt;
+    }
+    return router_->BuildRoute(from_vertex, to_vertex);
+}
+
+std::optional<graph::Router<double>::RouteInfo> TransportRouter::BuildRoute(std::string_view from, std::string_view to,
+                                                                            const RouterSettings& settings) const {
+    if (IsOwnSettings(settings) && router_ != nullptr) {
+        return BuildRoute(from, to);
+    }
+    const Stop* from_ptr = db_.FindStop(from);
+    const Stop* to_ptr = db_.FindStop(to);
+    if (from_ptr == nullptr || to_ptr == nullptr) {
+        return std::nullopt;
+    }
+    const graph::DirectedWeightedGraph<double>& graph = GetInitializedGraph();
+    const graph::VertexId from_vertex = stop_vertices_[from_ptr->id];
+    const graph::VertexId to_vertex = stop_vertices_[to_ptr->id];
+    if (!AreInSameComponent(from_vertex, to_vertex)) {
+        return std::nullopt;
+    }
+    if (IsOwnSettings(settings) && !hub_labels_.IsEmpty()) {
+        return hub_labels_.BuildRoute(graph, from_vertex, to_vertex);
+    }
+    if (IsOwnSettings(settings) && !landmarks_.IsEmpty()) {
+        graph::LandmarkPath<double> path(graph, landmarks_, from_vertex, to_vertex);
+        profile::GetProfiler().AddCounter("route_search_settled", static_cast<int64_t>(path.GetSettledCount()));
+        if (!path.IsFound()) {
+            return std::nullopt;
+        }
+        return graph::Router<double>::RouteInfo{path.GetWeight(), path.GetEdges()};
+    }
+    graph::ShortestPathTree<double> tree(graph, from_vertex, [this, &settings](const graph::Edge<double>& edge) {
+        return GetEdgeWeight(edge, settings);
+    }, std::nullopt, to_vertex);
+    profile::GetProfiler().AddCounter("route_search_settled", static_cast<int64_t>(tree.GetReached().size()));
+    if (!tree.IsReached(to_vertex)) {
+        return std::nullopt;
+    }
+    return graph::Router<double>::RouteInfo{tree.GetWeight(to_vertex), tree.GetEdges(to_vertex)};
+}
+
+std::optional<Journey> TransportRouter::FindJourney(std::string_view from, std::string_view to,
+                                                    const RouterSettings& settings) const {
+    if (backend_ == RoutingBackend::RAPTOR) {
+        auto journeys = FindJourneys(from, to, settings);
+        if (!journeys || journeys->empty()) {
+            return std::nullopt;
+        }
+        return std::move(journeys->back());
+    }
+    auto route = BuildRoute(from, to, settings);
+    if (!route) {
+        return std::nullopt;
+    }
+    return MakeJourney(*route, settings);
+}
+
+std::vector<std::optional<Journey>> TransportRouter::FindJourneysFrom(std::string_view from, const std::vector<std::string_view>& to,
+                                                                      const RouterSettings& settings) const {
+    std::vector<std::optional<Journey>> result(to.size());
+    const Stop* from_ptr = db_.FindStop(from);
+    if (from_ptr == nullptr) {
+        return result;
+    }
+    // the table and the labels answer a pair faster than any search. A* with landmarks
+    // may keep another of equal routes than a shared tree, so it also goes target by
+    // target: the answer mustn't depend on which requests were grouped
+    const bool precomputed = IsOwnSettings(settings) && (router_ != nullptr || !hub_labels_.IsEmpty());
+    const bool landmark_search = IsOwnSettings(settings) && !landmarks_.IsEmpty();
+    if (backend_ == RoutingBackend::RAPTOR || precomputed || landmark_search || to.size() < 2) {
+        for (size_t i = 0; i < to.size(); ++i) {
+            result[i] = FindJourney(from, to[i], settings);
+        }
+        return result;
+    }
+    const graph::DirectedWeightedGraph<double>& graph = GetInitializedGraph();
+    const graph::VertexId from_vertex = stop_vertices_[from_ptr->id];
+    std::vector<std::optional<graph::VertexId>> to_vertices(to.size());
+    std::vector<graph::VertexId> targets;
+    for (size_t i = 0; i < to.size(); ++i) {
+        const Stop* to_ptr = db_.FindStop(to[i]);
+        if (to_ptr != nullptr && AreInSameComponent(from_vertex, stop_vertices_[to_ptr->id])) {
+            to_vertices[i] = stop_vertices_[to_ptr->id];
+            targets.push_back(*to_vertices[i]);
+        }
+    }
+    if (targets.empty()) {
+        return result;
+    }
+    graph::ShortestPathTree<double> tree(graph, from_vertex, [this, &settings](const graph::Edge<double>& edge) {
+        return GetEdgeWeight(edge, settings);
+    }, targets);
+    profile::GetProfiler().AddCounter("route_search_settled", static_cast<int64_t>(tree.GetReached().size()));
+    for (size_t i = 0; i < to.size(); ++i) {
+        if (to_vertices[i] && tree.IsReached(*to_vertices[i])) {
+            result[i] = MakeJourney({tree.GetWeight(*to_vertices[i]), tree.GetEdges(*to_vertices[i])}, settings);
+        }
+    }
+    return result;
+}
+
+std::optional<std::vector<Journey>> TransportRouter::FindJourneys(std::string_view from, std::string_view to,
+                                                                  const RouterSettings& settings) const {
+    const Stop* from_ptr = db_.FindStop(from);
+    const Stop* to_ptr = db_.FindStop(to);
+    if (from_ptr == nullptr || to_ptr == nullptr) {
+        return std::nullopt;
+    }
+    return raptor_.FindJourneys(from_ptr->id, to_ptr->id, settings);
+}
+
+std::optional<std::vector<std::pair<size_t, double>>> TransportRouter::FindReachable(std::string_view from, double max_time,
+                                                                                     const RouterSettings& settings) const {
+    const Stop* from_ptr = db_.FindStop(from);
+    if (from_ptr == nullptr) {
+        return std::nullopt;
+    }
+    const graph::DirectedWeightedGraph<double>& graph = GetInitializedGraph();
+    const graph::VertexId from_vertex = stop_vertices_[from_ptr->id];
+    std::vector<std::pair<size_t, double>> result;
+    if (IsOwnSettings(settings) && router_ != nullptr) {
+        result = router_->GetReachable(from_vertex, max_time);
+        for (auto& [vertex, time] : result) {
+            vertex = vertex_stops_[vertex];
+        }
+    } else {
+        graph::ShortestPathTree<double> tree(graph, from_vertex, [this, &settings](const graph::Edge<double>& edge) {
+            return GetEdgeWeight(edge, settings);
+        }, max_time);
+        result.reserve(tree.GetReached().size());
+        for (graph::VertexId vertex : tree.GetReached()) {
+            result.push_back({vertex_stops_[vertex], tree.GetWeight(vertex)});
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+bool TransportRouter::IsOwnSettings(const RouterSettings& settings) const {
+    return settings.bus_wait_time == bus_wait_time_ && settings.bus_velocity == bus_velocity_;
+}
+
+Journey TransportRouter::MakeJourney(const graph::Router<double>::RouteInfo& route, const RouterSettings& settings) const {
+    const double wait_time = static_cast<double>(settings.bus_wait_time);
+    Journey journey{route.weight, {}};
+    journey.legs.reserve(route.edges.size());
+    for (graph::EdgeId edge_id : route.edges) {
+        const auto& edge = graph_->GetEdge(edge_id);
+        journey.legs.push_back({db_.GetStopById(vertex_stops_[edge.from]), db_.GetBusById(edge.bus_id),
+                                static_cast<int>(edge.stop_count), wait_time, GetEdgeWeight(edge, settings) - wait_time});
+    }
+    return journey;
+}
+
+bool TransportRouter::AreInSameComponent(graph::VertexId from, graph::VertexId to) const {
+    return components_.empty() || components_[from] == components_[to];
+}
+
+void TransportRouter::ComputeVertexOrder() {
+    const auto& stops = db_.GetStops();
+    if (stops.empty()) {
+        SetVertexOrder({});
+        return;
+    }
+    double min_lat = stops.front().coordinates.lat;
+    double max_lat = min_lat;
+    double min_lng = stops.front().coordinates.lng;
+    double max_lng = min_lng;
+    for (const Stop& stop : stops) {
+        min_lat = std::min(min_lat, stop.coordinates.lat);
+        max_lat = std::max(max_lat, stop.coordinates.lat);
+        min_lng = std::min(min_lng, stop.coordinates.lng);
+        max_lng = std::max(max_lng, stop.coordinates.lng);
+    }
+    auto to_cell = [](double value, double min, double max) {
+        constexpr double last_cell = (uint32_t{1} << HILBERT_ORDER) - 1;
+        return max > min ? static_cast<uint32_t>((value - min) / (max - min) * last_cell) : 0u;
+    };
+    std::vector<std::pair<uint64_t, size_t>> keys;
+    keys.reserve(stops.size());
+    for (const Stop& stop : stops) {
+        keys.push_back({GetHilbertIndex(to_cell(stop.coordinates.lng, min_lng, max_lng),
+                                        to_cell(stop.coordinates.lat, min_lat, max_lat)), stop.id});
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<graph::VertexId> stop_vertices(stops.size());
+    for (size_t vertex = 0; vertex < keys.size(); ++vertex) {
+        stop_vertices[keys[vertex].second] = vertex;
+    }
+    SetVertexOrder(std::move(stop_vertices));
+}
+
+void TransportRouter::SetVertexOrder(std::vector<graph::VertexId> stop_vertices) {
+    stop_vertices_ = std::move(stop_vertices);
+    vertex_stops_.assign(stop_vertices_.size(), 0);
+    for (size_t stop_id = 0; stop_id < stop_vertices_.size(); ++stop_id) {
+        vertex_stops_.at(stop_vertices_[stop_id]) = stop_id;
+    }
+}
+
+const graph::DirectedWeightedGraph<double>& TransportRouter::GetInitializedGraph() const {
+    if (backend_ == RoutingBackend::RAPTOR) {
+        // RAPTOR snapshots carry no graph; requests that search it build it once.
+        // The router is only shared as const, so the build happens behind graph_once_
+        std::call_once(graph_once_, [this]() {
+            const_cast<TransportRouter*>(this)->InitGraph();
+        });
+    }
+    if (graph_ == nullptr) {
+        throw std::logic_error("Router is not initialized");
+    }
+    return *graph_;
 }
 
 const graph::DirectedWeightedGraph<double>& TransportRouter::GetGraph() const {
@@ -94,5 +506,13 @@ const graph::DirectedWeightedGraph<double>& TransportRouter::GetGraph() const {
 const graph::Router<double>& TransportRouter::GetRouter() const {
     return *router_;
 }
+
+const std::vector<size_t>& TransportRouter::GetComponents() const {
+    return components_;
+}
+
+const std::vector<graph::VertexId>& TransportRouter::GetStopVertices() const {
+    return stop_vertices_;
+}
     
 } // end namespace transport
@@ -2,11 +2,16 @@
 
 #include "json.h"
 #include "transport_catalogue.h"
+#include "hub_labels.h"
+#include "landmarks.h"
+#include "raptor.h"
 #include "router.h"
 
 #include <string_view>
 #include <optional>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace transport {
     
@@ -14,29 +19,108 @@ struct RouterSettings {
     size_t bus_wait_time;
     double bus_velocity;
 };
+
+// TABLE precomputes all shortest paths, ALT keeps landmark distances and answers
+// Route requests by A* search, using memory linear in the number of stops.
+// HUB_LABELS answers them by merging two precomputed distance labels.
+// RAPTOR precomputes nothing and scans bus lines round by round; its graph is only
+// built when a request needs it (Isochrone) and isn't saved.
+enum class RoutingBackend {
+    TABLE,
+    ALT,
+    HUB_LABELS,
+    RAPTOR
+};
     
 class TransportRouter {
 public:
     TransportRouter(const TransportCatalogue& db);
-    void SetPointers(std::unique_ptr<graph::DirectedWeightedGraph<double>> g_ptr, std::unique_ptr<graph::Router<double>> r_ptr);
+    // Components are computed from the graph if not given, missing stop_vertices mean vertex id = stop id
+    void SetPointers(std::unique_ptr<graph::DirectedWeightedGraph<double>> g_ptr, std::unique_ptr<graph::Router<double>> r_ptr,
+                     std::vector<size_t> components = {}, std::vector<graph::VertexId> stop_vertices = {});
     void ApplySettings(const RouterSettings& settings);
     int GetBusWaitTime() const;
     double GetBusVelocity() const;
+    RouterSettings GetSettings() const;
     const graph::Edge<double>& GetEdge(size_t id) const;
+    // Weight of the edge under the given settings; the stored weight for the snapshot's own settings
+    double GetEdgeWeight(const graph::Edge<double>& edge, const RouterSettings& settings) const;
+    static double ComputeEdgeWeight(const RouterSettings& settings, double distance);
     void Init();
-    std::optional<graph::Router<double>::RouteInfo> BuildRoute(std::string_view from, std::string_view to);
+    void InitGraph();
+    // Dominated parallel edges are removed from a newly built graph unless disabled
+    void SetEdgePruning(bool enabled);
+    // Decides what Init() precomputes
+    void SetBackend(RoutingBackend backend, size_t landmark_count = DEFAULT_LANDMARK_COUNT);
+    RoutingBackend GetBackend() const;
+    size_t GetLandmarkCount() const;
+    // Init() takes the route tables of unchanged components from the previous router,
+    // which must outlive Init()
+    void SetPrevious(const TransportRouter* previous);
+    void SetLandmarks(graph::Landmarks<double> landmarks);
+    const graph::Landmarks<double>& GetLandmarks() const;
+    void SetHubLabels(graph::HubLabels<double> hub_labels);
+    const graph::HubLabels<double>& GetHubLabels() const;
+    bool HasRouter() const;
+    bool HasGraph() const;
+    // Init() must have been called or a router loaded with SetPointers()
+    std::optional<graph::Router<double>::RouteInfo> BuildRoute(std::string_view from, std::string_view to) const;
+    // Without a route table the snapshot's settings are answered by hub labels or by A* search
+    // with landmarks if there are any; other settings by a search with weights computed on the fly
+    std::optional<graph::Router<double>::RouteInfo> BuildRoute(std::string_view from, std::string_view to,
+                                                               const RouterSettings& settings) const;
+    // Fastest journey by the chosen backend
+    std::optional<Journey> FindJourney(std::string_view from, std::string_view to, const RouterSettings& settings) const;
+    // Fastest journeys from one stop to each of `to`, nullopt for unreachable ones. Plain Dijkstra
+    // searches are shared by all targets, the other backends answer every target by FindJourney
+    std::vector<std::optional<Journey>> FindJourneysFrom(std::string_view from, const std::vector<std::string_view>& to,
+                                                         const RouterSettings& settings) const;
+    // Journeys faster than any with fewer rides (RAPTOR with every backend), the last one is the fastest
+    std::optional<std::vector<Journey>> FindJourneys(std::string_view from, std::string_view to,
+                                                     const RouterSettings& settings) const;
+    // Stop ids reachable from `from` within max_time minutes with their travel times, in id order.
+    // Scans the precomputed table if there is one, otherwise runs a bounded Dijkstra on the graph.
+    std::optional<std::vector<std::pair<size_t, double>>> FindReachable(std::string_view from, double max_time,
+                                                                        const RouterSettings& settings) const;
     const graph::DirectedWeightedGraph<double>& GetGraph() const;
     const graph::Router<double>& GetRouter() const;
+    // Weakly connected component of every graph vertex
+    const std::vector<size_t>& GetComponents() const;
+    // Graph vertices are stops renumbered along a Hilbert curve, so that stops
+    // close to each other are close in the graph and in the route tables
+    const std::vector<graph::VertexId>& GetStopVertices() const;
+
 
+    static constexpr size_t DEFAULT_LANDMARK_COUNT = 16;
     
 private:
     void BuildGraph();
+    void BuildRaptor();
+    double GetSegmentDistance(const Stop* from, const Stop* to) const;
+    void PruneGraph();
+    void ComputeVertexOrder();
+    void SetVertexOrder(std::vector<graph::VertexId> stop_vertices);
+    bool IsOwnSettings(const RouterSettings& settings) const;
+    Journey MakeJourney(const graph::Router<double>::RouteInfo& route, const RouterSettings& settings) const;
+    bool AreInSameComponent(graph::VertexId from, graph::VertexId to) const;
+    const graph::DirectedWeightedGraph<double>& GetInitializedGraph() const;
 
     size_t bus_wait_time_ = 1;
     double bus_velocity_ = 1.0;
+    bool edge_pruning_ = true;
+    RoutingBackend backend_ = RoutingBackend::TABLE;
+    size_t landmark_count_ = DEFAULT_LANDMARK_COUNT;
+    const TransportRouter* previous_ = nullptr;
     const TransportCatalogue& db_;
     std::unique_ptr<graph::DirectedWeightedGraph<double>> graph_;
+    mutable std::once_flag graph_once_;
     std::unique_ptr<graph::Router<double>> router_;
+    graph::Landmarks<double> landmarks_;
+    graph::HubLabels<double> hub_labels_;
+    Raptor raptor_;
+    std::vector<size_t> components_;
+    std::vector<graph::VertexId> stop_vertices_;
+    std::vector<size_t> vertex_stops_;
 };
     
 } // end namespace transport